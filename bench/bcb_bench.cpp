@@ -0,0 +1,204 @@
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "replacers.h"
+
+/**
+ * 比较原先 48 字节, 以指针链接的 BCB 与现在 32 字节对齐, 以 frame_id 链接的 BCB 在替换算法热路径上的开销
+ *
+ * 用法: bcb_bench [num_frames...], 默认测试 1024, 65536 与 1048576 个 frame.
+ * 两种 BCB 都以 frame_id 为下标连续存放, 按随机顺序组成 LRU 链表, 之后测量:
+ * 1. hit: 按 zipf 式偏斜选出 frame, pin/unpin 并移到 LRU 链表尾部, 即一次命中对 BCB 的全部访问
+ * 2. scan: 从链表头遍历整个链表, 即 scan_cold 与替换算法扫描的访问模式
+ * 输出每次操作的纳秒数, 以及通过 perf_event_open 得到的每次操作的 cache miss 数 (没有权限时不输出).
+*/
+
+// 与原 BCB 相同的布局
+struct OldBCB {
+    int page_id;
+    int frame_id;
+    std::atomic<int> latch;
+    std::atomic<int> count;
+    std::atomic<int> dirty;
+    std::atomic<bool> prefetched;
+    std::atomic<bool> parked;
+    OldBCB *algo_next;
+    OldBCB *algo_prev;
+    union {
+        int time[2];
+        int access_times;
+    };
+};
+
+class OldList {
+public:
+    OldBCB *head = nullptr, *tail = nullptr;
+    void insert_tail(OldBCB *bcb) {
+        bcb->algo_next = nullptr;
+        bcb->algo_prev = tail;
+        if (tail != nullptr) {
+            tail->algo_next = bcb;
+        } else {
+            head = bcb;
+        }
+        tail = bcb;
+    }
+    void remove(OldBCB *bcb) {
+        if (bcb->algo_prev) {
+            bcb->algo_prev->algo_next = bcb->algo_next;
+        } else {
+            head = bcb->algo_next;
+        }
+        if (bcb->algo_next) {
+            bcb->algo_next->algo_prev = bcb->algo_prev;
+        } else {
+            tail = bcb->algo_prev;
+        }
+    }
+    static OldBCB *next(OldBCB *bcb) { return bcb->algo_next; }
+};
+
+class NewList: public LinkedList {
+public:
+    static BCB *next(BCB *bcb) { return bcb->next(); }
+};
+
+// 硬件 cache miss 计数器, 打开失败时 valid() 为 false
+class CacheMissCounter {
+public:
+    CacheMissCounter() {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        m_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    ~CacheMissCounter() {
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+    }
+    bool valid() const { return m_fd >= 0; }
+    void start() {
+        if (m_fd >= 0) {
+            ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    long long stop() {
+        long long value = 0;
+        if (m_fd >= 0) {
+            ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(m_fd, &value, sizeof(value)) != sizeof(value)) {
+                value = 0;
+            }
+        }
+        return value;
+    }
+private:
+    int m_fd;
+};
+
+struct Result {
+    double ns;
+    double misses;
+};
+
+template <typename Node, typename List>
+static void bench(const char *name, int num_frames, const std::vector<int> &order, const std::vector<int> &hits,
+    CacheMissCounter &counter, long long &checksum)
+{
+    std::vector<Node> nodes(num_frames);
+    List list;
+    for (int i = 0; i < num_frames; i++) {
+        nodes[i].page_id = i;
+        nodes[i].frame_id = i;
+    }
+    for (int frame_id : order) {
+        list.insert_tail(&nodes[frame_id]);
+    }
+    // hit
+    counter.start();
+    auto before = std::chrono::high_resolution_clock::now();
+    for (int frame_id : hits) {
+        Node *bcb = &nodes[frame_id];
+        bcb->count++;
+        checksum += bcb->page_id;
+        list.remove(bcb);
+        list.insert_tail(bcb);
+        bcb->count--;
+    }
+    auto after = std::chrono::high_resolution_clock::now();
+    Result hit {std::chrono::duration<double, std::nano>(after - before).count() / hits.size(),
+        (double)counter.stop() / hits.size()};
+    // scan
+    const int rounds = std::max(1, 10000000 / num_frames);
+    counter.start();
+    before = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (Node *p = list.head; p != nullptr; p = List::next(p)) {
+            checksum += p->count;
+        }
+    }
+    after = std::chrono::high_resolution_clock::now();
+    double visits = (double)rounds * num_frames;
+    Result scan {std::chrono::duration<double, std::nano>(after - before).count() / visits, (double)counter.stop() / visits};
+    std::cout << "    " << name << " (" << sizeof(Node) << " bytes): "
+        << "hit " << hit.ns << " ns/op, scan " << scan.ns << " ns/node";
+    if (counter.valid()) {
+        std::cout << ", cache misses: hit " << hit.misses << "/op, scan " << scan.misses << "/node";
+    }
+    std::cout << std::endl;
+}
+
+static void run(int num_frames)
+{
+    const int num_hits = 10000000;
+    std::mt19937 gen(42);
+    // 链表的初始顺序是随机的, 模拟运行一段时间后链表顺序与 frame_id 无关的情况
+    std::vector<int> order(num_frames);
+    for (int i = 0; i < num_frames; i++) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), gen);
+    std::vector<int> hits(num_hits);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    for (int i = 0; i < num_hits; i++) {
+        hits[i] = order[(int)(num_frames * unit(gen) * unit(gen))];
+    }
+    CacheMissCounter counter;
+    long long checksum = 0;
+    std::cout << "frames: " << num_frames << std::endl;
+    bench<OldBCB, OldList>("pointer links", num_frames, order, hits, counter, checksum);
+    bench<BCB, NewList>("32-bit index links", num_frames, order, hits, counter, checksum);
+    if (!counter.valid()) {
+        std::cout << "    cache misses: perf_event_open unavailable" << std::endl;
+    }
+    std::cout << "    checksum: " << checksum << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            run(atoi(argv[i]));
+        }
+    } else {
+        run(1024);
+        run(65536);
+        run(1048576);
+    }
+    return 0;
+}
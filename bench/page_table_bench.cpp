@@ -0,0 +1,123 @@
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include "page_table.h"
+
+/**
+ * 比较 PageTable 与原先 page_id % DEFBUFSIZE 取模哈希加 BCB 溢出链表的查找开销
+ *
+ * 用法: page_table_bench [num_frames...], 默认测试 1024, 65536 与 1048576 个 frame.
+ * 对每种 frame 数量, 从 50 倍大小的 page 空间中随机选出 num_frames 个 page 放入表中,
+ * 然后按 zipf 分布随机查找, 输出每次查找的平均纳秒数.
+*/
+
+// 与原 BCB 相同大小的链表结点, 逐个 new 出来
+struct ChainNode {
+    int page_id;
+    int frame_id;
+    int latch;
+    int count;
+    int dirty;
+    ChainNode *next;
+    ChainNode *algo_next;
+    ChainNode *algo_prev;
+    int time[2];
+};
+
+class ChainTable {
+public:
+    explicit ChainTable(int num_buckets): m_buckets(num_buckets, nullptr) {}
+    ~ChainTable() {
+        for (ChainNode *head : m_buckets) {
+            while (head) {
+                ChainNode *next = head->next;
+                delete head;
+                head = next;
+            }
+        }
+    }
+    void insert(int page_id, int frame_id) {
+        ChainNode *node = new ChainNode {page_id, frame_id};
+        int bucket = page_id % (int)m_buckets.size();
+        node->next = m_buckets[bucket];
+        m_buckets[bucket] = node;
+    }
+    int find(int page_id) const {
+        for (ChainNode *p = m_buckets[page_id % (int)m_buckets.size()]; p != nullptr; p = p->next) {
+            if (p->page_id == page_id) {
+                return p->frame_id;
+            }
+        }
+        return -1;
+    }
+private:
+    std::vector<ChainNode *> m_buckets;
+};
+
+template <typename Table>
+static double bench_lookup(const Table &table, const std::vector<int> &lookups, long long &checksum)
+{
+    auto before = std::chrono::high_resolution_clock::now();
+    for (int page_id : lookups) {
+        checksum += table.find(page_id);
+    }
+    auto after = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(after - before).count() / lookups.size();
+}
+
+static void run(int num_frames)
+{
+    const int num_pages = num_frames * 50;
+    const int num_lookups = 10000000;
+    std::mt19937 gen(42);
+    // 以随机顺序分配结点, 模拟运行一段时间后 BCB 在堆上分散的情况
+    std::vector<int> pages(num_pages);
+    for (int i = 0; i < num_pages; i++) {
+        pages[i] = i;
+    }
+    std::shuffle(pages.begin(), pages.end(), gen);
+    pages.resize(num_frames);
+
+    ChainTable chains {num_frames};
+    PageTable table {2 * num_frames};
+    for (int i = 0; i < num_frames; i++) {
+        chains.insert(pages[i], i);
+        table.insert(pages[i], i);
+    }
+    // 查找序列: 80% 落在驻留的 page 上 (zipf 式偏斜), 20% 为未命中
+    std::vector<int> lookups(num_lookups);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_int_distribution<int> any_page(0, num_pages - 1);
+    for (int i = 0; i < num_lookups; i++) {
+        if (unit(gen) < 0.8) {
+            int rank = (int)(num_frames * unit(gen) * unit(gen));
+            lookups[i] = pages[rank];
+        } else {
+            lookups[i] = any_page(gen);
+        }
+    }
+    long long checksum = 0;
+    double chain_ns = bench_lookup(chains, lookups, checksum);
+    double table_ns = bench_lookup(table, lookups, checksum);
+    std::cout << "frames: " << num_frames << std::endl
+        << "    chained (mod " << num_frames << "): " << chain_ns << " ns/lookup" << std::endl
+        << "    open addressing (" << table.capacity() << " slots): " << table_ns << " ns/lookup" << std::endl
+        << "    checksum: " << checksum << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            run(atoi(argv[i]));
+        }
+    } else {
+        run(1024);
+        run(65536);
+        run(1048576);
+    }
+    return 0;
+}
@@ -0,0 +1,205 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include "buffer.h"
+#include "options.h"
+#include "workload.h"
+
+/**
+ * 合成 workload 上各个替换算法的基准测试
+ *
+ * 对每个 workload, 算法与缓冲区大小的组合重复 reps 次, 每次用新的 DataStorageManager 与 BufferManager 回放
+ * 在内存中生成的访问序列, 输出吞吐量, 单次 fix_page + unfix_page 的延迟分位数, 命中率与 I/O 次数.
+ * 默认以 --io none 方式运行, 不做真实 I/O, 只测量缓冲区管理器本身的热路径; 延迟每 sample 次访问计时一次,
+ * 吞吐量按整个回放的时间计算. 每次运行输出一行 CSV 或 JSON, 可以直接用于回归比较.
+ * hot hit rate 为不属于顺序扫描的访问的命中率; 指定 --scan-strategy 时顺序扫描的访问使用 SEQ_SCAN 访问策略,
+ * 比较两者可以看出扫描对热数据的影响.
+*/
+
+#define BENCHDB "bench.dbf" // --io 不为 none 时使用的数据库文件, 每次运行前删除, 重新创建
+
+struct BenchResult {
+    double seconds;
+    long long p50, p99, p999; // 纳秒
+    int hits;
+    int io_count;
+    double hot_hit_rate;
+};
+
+// 打开数据库文件失败时返回 false
+static bool bench(const Trace &trace, const std::vector<uint8_t> &scans, bool scan_strategy, int num_pages,
+    Replacer::Algo algo, int num_frames, DataStorageManager::IoMode io_mode, int sample, BenchResult &result)
+{
+    if (io_mode != DataStorageManager::NONE) {
+        std::remove(BENCHDB);
+    }
+    auto *dsmgr = new DataStorageManager {PAGESIZE, num_pages};
+    if (!dsmgr->open_file(BENCHDB, io_mode)) {
+        delete dsmgr;
+        return false;
+    }
+    while (dsmgr->get_num_pages() < num_pages && dsmgr->inc_num_pages() >= 0) {
+    }
+    dsmgr->io_count = 0;
+    auto *bufmgr = new BufferManager {dsmgr, algo, num_frames};
+    AccessStrategy scan {AccessStrategy::SEQ_SCAN};
+    long long hot_accesses = 0, hot_hits = 0;
+    auto access = [&](size_t i) {
+        AccessStrategy *strategy = scan_strategy && scans[i] ? &scan : nullptr;
+        int hits = bufmgr->hit_count;
+        bufmgr->fix_page(trace.page_id(i), trace.write(i), strategy);
+        bufmgr->unfix_page(trace.page_id(i));
+        if (!scans[i]) {
+            hot_accesses++;
+            hot_hits += bufmgr->hit_count - hits;
+        }
+    };
+    std::vector<long long> latencies;
+    latencies.reserve(trace.size() / sample + 1);
+    auto before = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < trace.size(); i++) {
+        if (i % sample == 0) {
+            auto start = std::chrono::steady_clock::now();
+            access(i);
+            latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        } else {
+            access(i);
+        }
+    }
+    auto after = std::chrono::steady_clock::now();
+    bufmgr->release_strategy(&scan);
+    result.seconds = std::chrono::duration_cast<std::chrono::duration<double>>(after - before).count();
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+        return latencies.empty() ? 0 : latencies[std::min(latencies.size() - 1, (size_t)(p * latencies.size()))];
+    };
+    result.p50 = percentile(0.5);
+    result.p99 = percentile(0.99);
+    result.p999 = percentile(0.999);
+    result.hits = bufmgr->hit_count;
+    result.io_count = dsmgr->io_count;
+    result.hot_hit_rate = hot_accesses > 0 ? (double)hot_hits / hot_accesses : 0;
+    delete bufmgr;
+    dsmgr->close_file();
+    delete dsmgr;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    bool parse_fail = false;
+    std::vector<std::string> workload_names = {"zipf", "uniform", "scan", "scan-hot", "shifting"};
+    std::vector<std::string> algo_names = {"lru", "mru", "random", "clock", "lru-2", "2q", "lru-k", "arc", "car", "clock-pro"};
+    std::vector<int> pool_sizes = {1024, 4096};
+    WorkloadParams params;
+    params.num_accesses = 200000;
+    int reps = 3;
+    int sample = 16;
+    bool json = false;
+    bool scan_strategy = false;
+    DataStorageManager::IoMode io_mode = DataStorageManager::NONE;
+    for (int i = 1; i < argc && !parse_fail; i++) {
+        std::string option = argv[i];
+        if (option == "--workloads" && i + 1 < argc) {
+            workload_names = split_list(argv[++i]);
+        } else if (option == "--algos" && i + 1 < argc) {
+            algo_names = split_list(argv[++i]);
+        } else if (option == "--pool-sizes" && i + 1 < argc) {
+            pool_sizes.clear();
+            for (const std::string &item : split_list(argv[++i])) {
+                pool_sizes.push_back(atoi(item.c_str()));
+                parse_fail = parse_fail || pool_sizes.back() <= 0;
+            }
+        } else if (option == "--pages" && i + 1 < argc) {
+            params.num_pages = atoi(argv[++i]);
+            parse_fail = params.num_pages <= 0;
+        } else if (option == "--accesses" && i + 1 < argc) {
+            params.num_accesses = (size_t)atoll(argv[++i]);
+            parse_fail = params.num_accesses == 0;
+        } else if (option == "--skew" && i + 1 < argc) {
+            params.skew = atof(argv[++i]);
+            parse_fail = params.skew < 0;
+        } else if (option == "--write-ratio" && i + 1 < argc) {
+            params.write_ratio = atof(argv[++i]);
+            parse_fail = params.write_ratio < 0 || params.write_ratio > 1;
+        } else if (option == "--scan-interval" && i + 1 < argc) {
+            params.scan_interval = atoi(argv[++i]);
+            parse_fail = params.scan_interval < 0;
+        } else if (option == "--shift-interval" && i + 1 < argc) {
+            params.shift_interval = atoi(argv[++i]);
+            parse_fail = params.shift_interval < 0;
+        } else if (option == "--seed" && i + 1 < argc) {
+            params.seed = (unsigned)atoi(argv[++i]);
+        } else if (option == "--reps" && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+            parse_fail = reps <= 0;
+        } else if (option == "--sample" && i + 1 < argc) {
+            sample = atoi(argv[++i]);
+            parse_fail = sample <= 0;
+        } else if (option == "--io" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            io_mode = mode == "pread" ? DataStorageManager::PREAD : DataStorageManager::NONE;
+            parse_fail = mode != "pread" && mode != "none";
+        } else if (option == "--scan-strategy") {
+            scan_strategy = true;
+        } else if (option == "--format" && i + 1 < argc) {
+            std::string format = argv[++i];
+            json = format == "json";
+            parse_fail = format != "json" && format != "csv";
+        } else {
+            parse_fail = true;
+        }
+    }
+    std::vector<Workload::Kind> workloads(workload_names.size());
+    for (size_t i = 0; i < workload_names.size() && !parse_fail; i++) {
+        parse_fail = !Workload::parse(workload_names[i], workloads[i]);
+    }
+    std::vector<Replacer::Algo> algos(algo_names.size());
+    for (size_t i = 0; i < algo_names.size() && !parse_fail; i++) {
+        parse_fail = !parse_algo(algo_names[i], algos[i]);
+    }
+    if (parse_fail) {
+        std::cout << "error: wrong format, please use" << std::endl;
+        std::cout << "    workload_bench [--workloads zipf,uniform,scan,scan-hot,shifting] [--algos ALGO,...] [--pool-sizes FRAMES,...]" << std::endl;
+        std::cout << "        [--pages PAGES] [--accesses N] [--skew S] [--write-ratio RATIO] [--scan-interval N] [--shift-interval N]" << std::endl;
+        std::cout << "        [--seed SEED] [--reps N] [--sample N] [--io none|pread] [--scan-strategy] [--format csv|json]" << std::endl;
+        return -1;
+    }
+    if (!json) {
+        std::cout << "workload,algo,pool size,rep,accesses,throughput,p50 ns,p99 ns,p99.9 ns,hit rate,io count,hot hit rate" << std::endl;
+    }
+    for (size_t w = 0; w < workloads.size(); w++) {
+        Trace trace;
+        std::vector<uint8_t> scans;
+        Workload::generate(workloads[w], params, trace, &scans);
+        for (size_t a = 0; a < algos.size(); a++) {
+            for (int num_frames : pool_sizes) {
+                for (int rep = 0; rep < reps; rep++) {
+                    BenchResult result;
+                    if (!bench(trace, scans, scan_strategy, params.num_pages, algos[a], num_frames, io_mode, sample, result)) {
+                        std::cout << "error: cannot open " << BENCHDB << std::endl;
+                        return -1;
+                    }
+                    double throughput = trace.size() / result.seconds;
+                    double hit_rate = (double)result.hits / trace.size();
+                    if (json) {
+                        std::cout << "{\"workload\":\"" << workload_names[w] << "\",\"algo\":\"" << algo_names[a]
+                            << "\",\"pool_size\":" << num_frames << ",\"rep\":" << rep << ",\"accesses\":" << trace.size()
+                            << ",\"throughput\":" << throughput << ",\"p50_ns\":" << result.p50 << ",\"p99_ns\":" << result.p99
+                            << ",\"p999_ns\":" << result.p999 << ",\"hit_rate\":" << hit_rate << ",\"io_count\":" << result.io_count
+                            << ",\"hot_hit_rate\":" << result.hot_hit_rate << "}" << std::endl;
+                    } else {
+                        std::cout << workload_names[w] << "," << algo_names[a] << "," << num_frames << "," << rep << ","
+                            << trace.size() << "," << throughput << "," << result.p50 << "," << result.p99 << ","
+                            << result.p999 << "," << hit_rate << "," << result.io_count << "," << result.hot_hit_rate << std::endl;
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+#include <sys/uio.h>
+#include "data_storage.h"
+
+#define AIODEPTH 64 // 默认的最大在途请求数
+#define AIOTHREADS 4 // 线程池引擎的工作线程数
+#define URINGRETRIES 1000 // io_uring_enter 被信号打断或暂时无法接收请求时的重试次数
+#define AIOBUCKETS 32 // 延迟直方图的桶数, 第 i 个桶为 [2^(i-1), 2^i) 微秒
+
+/**
+ * DataStorageManager 之下的异步 page I/O
+ *
+ * 文件以 PREAD/DIRECT 方式打开且内核支持时使用 io_uring, 直接在 frame 上完成读写, 不经过额外的拷贝,
+ * 每个请求使用其 page 所在数据文件的描述符;
+ * 否则 (或者指定 THREAD_POOL 时) 由 AIOTHREADS 个工作线程调用 read_page/write_page 完成.
+ * 至多同时有 queue_depth 个请求在途, 提交时没有空闲的请求槽位则阻塞.
+ * 请求有两种完成方式: 提交时返回 ticket, 之后由提交者调用 wait 取得结果; 或者给出回调, 在完成线程中调用.
+ * 回调中不能再提交请求或调用 wait. 所有接口都可以被多个线程同时调用.
+ * io_uring 提交失败 (重试后仍失败) 的请求撤回后在提交线程中用 read_page/write_page 同步完成, 回调也在提交线程中调用.
+ * 线程池与同步完成的请求由 DataStorageManager 记录 Stats 中的读写统计, io_uring 完成的请求在完成时记录.
+*/
+class AsyncIo {
+public:
+    enum Engine {IO_URING, THREAD_POOL};
+    using Callback = std::function<void(int result)>;
+    AsyncIo(DataStorageManager *dsmgr, Engine engine = IO_URING, int queue_depth = AIODEPTH);
+    ~AsyncIo();
+    AsyncIo(const AsyncIo &) = delete;
+    AsyncIo &operator=(const AsyncIo &) = delete;
+    int submit_read(int page_id, char *frame); // 返回 ticket
+    int submit_write(int page_id, const char *frame);
+    void submit_read(int page_id, char *frame, Callback callback);
+    void submit_write(int page_id, const char *frame, Callback callback);
+    int wait(int ticket); // 等待请求完成, 返回值同 read_page/write_page
+    void drain(); // 等待所有在途请求完成
+    Engine get_engine() const { return m_engine; }
+    void print_stats(std::ostream &out) const;
+private:
+    struct Request {
+        int page_id;
+        char *frame;
+        bool write;
+        bool done;
+        int result;
+        struct iovec iov;
+        Callback callback;
+        std::chrono::steady_clock::time_point start;
+    };
+    int submit(int page_id, char *frame, bool write, Callback callback);
+    void complete(int slot, int result, bool from_ring = false); // from_ring 为 true 时记录 Stats 中的读写统计
+    // io_uring
+    bool uring_setup();
+    void uring_submit(int slot, int page_id, bool write);
+    bool uring_enter();
+    void uring_reap();
+    // 线程池
+    void pool_work();
+
+    DataStorageManager *m_dsmgr;
+    Engine m_engine;
+    int m_queue_depth;
+    // 请求槽位
+    std::mutex m_slot_latch;
+    std::condition_variable m_slot_cond;
+    std::vector<Request> m_requests;
+    std::vector<int> m_free_slots;
+    // io_uring 的共享内存环
+    int m_ring_fd;
+    std::mutex m_sq_latch;
+    unsigned *m_sq_head, *m_sq_tail, *m_sq_mask, *m_sq_array;
+    unsigned *m_cq_head, *m_cq_tail, *m_cq_mask;
+    struct io_uring_sqe *m_sqes;
+    struct io_uring_cqe *m_cqes;
+    void *m_sq_ptr, *m_cq_ptr;
+    size_t m_sq_size, m_cq_size, m_sqes_size;
+    // 线程池
+    std::deque<int> m_pending;
+    std::condition_variable m_pending_cond;
+    bool m_stop;
+    std::vector<std::thread> m_threads; // io_uring 时为一个完成线程
+    // 统计
+    std::atomic<int> m_in_flight;
+    std::atomic<int> m_max_depth;
+    std::atomic<long long> m_depth_sum;
+    std::atomic<long long> m_reads, m_writes;
+    std::atomic<long long> m_read_latency[AIOBUCKETS];
+    std::atomic<long long> m_write_latency[AIOBUCKETS];
+};
@@ -1,82 +1,328 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "async_io.h"
+#include "compressed_cache.h"
 #include "data_storage.h"
+#include "page_table.h"
+#include "stats.h"
 
-#define FRAMESIZE 4096
-#define DEFBUFSIZE 1024
+#define DEFBUFSIZE 1024 // 默认的 frame 数量, frame 大小与 DataStorageManager 的 page 大小相同
+#define PTSHARDS 16 // 并发模式下哈希表的分片数, 每个分片有独立的锁
+#define HUGEPAGESIZE (2 << 20) // frame 区域不小于该大小时按大页对齐分配
+#define AIOSPARES 8 // 异步写回使用的备用 frame 数, 不计入缓冲区大小
+#define CLEANINTERVAL 1 // 后台写回线程每轮之间的间隔 (毫秒)
+#define CLEANBURST 100 // 限速时写回额度至多累积多少毫秒的量
+#define READAHEADTRIGGER 2 // 连续多少次访问的步长相同时认为是顺序/等步长访问
+#define READAHEADMAXSTRIDE 16 // 步长绝对值超过该值时不预读
+#define PREFETCHSHARE 4 // 2Q 与 LRU-2 中预取而尚未被访问的 page 至多占 1 / PREFETCHSHARE 的 frame
+#define SCANRING 32 // 顺序扫描策略默认的环大小 (frame 数)
+#define BULKRING 128 // 批量写入策略默认的环大小, 较大的环使 dirty page 在被回收写回前有更多机会被合并修改
+#define RINGSHARE 8 // 每个环至多占 1 / RINGSHARE 的 frame
 
-struct Frame {
-    char field[FRAMESIZE];
-};
-
-struct BCB
+/**
+ * frame 的控制块, 以 frame_id 为下标存放在连续的数组中. 每个 BCB 32 字节并按 32 字节对齐, 不会跨越 cache line,
+ * 命中时只访问一条 cache line. 替换算法的双向链表以 32 位的 frame_id 而非指针链接,
+ * 各个算法特有的元数据 (LRU-2 的访问时间, 2Q 的访问次数) 由替换算法以 frame_id 为下标保存在自己的数组中
+*/
+struct alignas(32) BCB
 {
-    BCB(int page_id, int frame_id): page_id(page_id), frame_id(frame_id), latch(0), count(0), dirty(0), next(nullptr) {};
+    static constexpr uint32_t NIL = UINT32_MAX; // 链表中没有前驱/后继
+    BCB(): BCB(-1, -1) {}
+    BCB(int page_id, int frame_id): page_id(page_id), frame_id(frame_id), latch(0), count(0), dirty(0), prefetched(false), parked(false),
+        ringed(false), algo_next(NIL), algo_prev(NIL) {};
+    // frame 的共享/独占 latch, 读入 page 时独占, 其它线程共享持有以等待读入完成
+    void latch_shared();
+    void unlatch_shared();
+    void latch_exclusive();
+    void unlatch_exclusive();
+    // 替换算法的链表, 前驱/后继与自身在同一个数组中, 由 frame_id 之差得到其地址
+    BCB *next() { return algo_next == NIL ? nullptr : this + ((int)algo_next - frame_id); }
+    BCB *prev() { return algo_prev == NIL ? nullptr : this + ((int)algo_prev - frame_id); }
+    void set_next(BCB *bcb) { algo_next = bcb == nullptr ? NIL : (uint32_t)bcb->frame_id; }
+    void set_prev(BCB *bcb) { algo_prev = bcb == nullptr ? NIL : (uint32_t)bcb->frame_id; }
     int page_id;
     int frame_id;
-    int latch;
-    int count;
-    int dirty;
-    BCB *next;
-    // 以下为替换算法使用
-    BCB *algo_next; // 双向链表
-    BCB *algo_prev;
-    union {
-        int time[2]; // LRU-2 使用的时间(用访问次数当作时间), 0 为倒数第 1 次时间, 1 为倒数第 2 次时间
-        int referenced; // CLOCK 使用
-        int access_times; // 2Q 使用, 访问过 0 次, 1 次, 2 次
-    };
+    std::atomic<int> latch; // 0 为空闲, 大于 0 为共享持有者数, -1 为独占
+    std::atomic<int> count;
+    std::atomic<char> dirty;
+    std::atomic<bool> prefetched; // 由预取读入且尚未被访问过, 在 replacer 锁下修改
+    std::atomic<bool> parked; // 被 pin 住而移出了 replacer 的可换出范围, 在 replacer 锁下修改
+    std::atomic<bool> ringed; // 属于某个访问策略的环而不在 replacer 中, 在 replacer 锁下修改
+    // 替换算法的双向链表
+    uint32_t algo_next;
+    uint32_t algo_prev;
 };
+static_assert(sizeof(BCB) == 32, "BCB should fill half a cache line");
 
 struct PageFrame {
     int page_id;
     int frame_id;
 };
 
+// fix_pages 的一个请求, frame_id 为结果, 失败时为 -1
+struct PageRequest {
+    int page_id;
+    bool write;
+    int frame_id;
+};
+
+/**
+ * fix_page 的访问策略, 由调用者为一组访问 (一次顺序扫描或批量写入) 创建, 用完后交给 release_strategy
+ *
+ * 1. NORMAL: 与不给出策略相同
+ * 2. SEQ_SCAN: 未命中的 page 读入策略私有的 frame 环, 环满后按顺序原地回收环中最早的 frame (dirty 时与换出相同地写回),
+ *    不插入 replacer; 命中也不通知 replacer, 因而一次大扫描不会冲掉其它调用者的热数据
+ * 3. BULK_WRITE: 同 SEQ_SCAN, 但默认的环较大
+ * 环中的 page 仍在哈希表中, 可以被其它调用者命中: 普通访问命中时该 frame 移交给 replacer, 环回收到它时另取 frame;
+ * 回收时被其它调用者 pin 住的 frame 同样移交给 replacer, 按预取的 page 放在冷端. 环大小至多为缓冲区的 1 / RINGSHARE.
+ * 一个策略同一时刻只能被一个线程使用, 不同线程的策略互不影响.
+*/
+class AccessStrategy {
+public:
+    enum Kind {NORMAL, SEQ_SCAN, BULK_WRITE};
+    AccessStrategy(Kind kind, int ring_size = 0): m_kind(kind), m_next(0) { // 0 为按 kind 的默认大小
+        m_ring_size = ring_size > 0 ? ring_size : kind == BULK_WRITE ? BULKRING : SCANRING;
+    }
+    Kind get_kind() const { return m_kind; }
+    int get_ring_size() const { return m_ring_size; }
+private:
+    template <typename Policy> friend class BasicBufferManager;
+    Kind m_kind;
+    int m_ring_size;
+    std::vector<int> m_frames; // 环中的 frame_id
+    int m_next; // 环满后下一个回收的位置
+};
+
+/**
+ * 仅在并发模式下才真正加锁的互斥锁守卫, 非并发模式下所有操作都是空操作
+*/
+class ScopedLatch {
+public:
+    ScopedLatch(std::mutex &latch, bool enabled): m_latch(latch), m_enabled(enabled), m_owned(false) { lock(); }
+    ScopedLatch(std::mutex &latch, bool enabled, std::defer_lock_t): m_latch(latch), m_enabled(enabled), m_owned(false) {}
+    ~ScopedLatch() { unlock(); }
+    void lock() {
+        if (m_enabled) {
+            m_latch.lock();
+        }
+        m_owned = true;
+    }
+    bool try_lock() {
+        m_owned = !m_enabled || m_latch.try_lock();
+        return m_owned;
+    }
+    void unlock() {
+        if (m_owned && m_enabled) {
+            m_latch.unlock();
+        }
+        m_owned = false;
+    }
+private:
+    std::mutex &m_latch;
+    bool m_enabled;
+    bool m_owned;
+};
+
+// 替换算法的可调参数, 只被用到它的算法读取
+struct ReplacerParams {
+    int k = 2; // LRU-K 的 K
+    int correlated_period = 0; // LRU-K 的相关访问周期, 以访问次数计, 0 为没有
+    int retained_history = 0; // LRU-K 换出后保留历史的 page 数, 0 为不保留
+    // 2Q 的 A1in 与 A1out 大小占 frame 数的比例, 原论文建议 0.25 与 0.5, 这里取在 data-5w-50w-zipf.txt 上用 --sweep 得到的较优值
+    double kin = 0.05;
+    double kout = 0.25;
+};
+
 /**
  * Replacement Algorithm
  * 
  * 替换算法借助 BCB 来实现, 但不拥有 BCB 的所有权
+ * 替换算法本身不加锁, 并发模式下由 BufferManager 持有 replacer 锁后调用, 只有 lock_free_access 的算法的 access_frame 例外
 */
 class Replacer {
 public:
-    enum Algo {LRU, MRU, RANDOM, CLOCK, LRU_2, TWO_QUEUE};
-    static Replacer *create(Algo algo);
+    enum Algo {LRU, MRU, RANDOM, CLOCK, LRU_2, TWO_QUEUE, LRU_K, ARC, CAR, CLOCK_PRO};
+    // num_frames 为 frame_id 的范围 (包括备用 frame), 按它分配以 frame_id 为下标的数组;
+    // capacity 为同时驻留的 page 数, 即缓冲区大小, 与大小有关的参数 (目标大小, 队列长度等) 按它计算
+    static Replacer *create(Algo algo, int num_frames, int capacity, const ReplacerParams &params = ReplacerParams());
     virtual Algo get_algo() const = 0;
     virtual ~Replacer() {};
     // 当访问缓存中某 frame 时调用调用
     virtual void access_frame(BCB *bcb, bool write) = 0;
+    // 为 true 时 access_frame 可以不持有 replacer 锁调用 (只修改原子的访问位), 调用时 BCB 被 pin 住且未被 park
+    virtual bool lock_free_access() const { return false; }
     // 当某 frame 被替换出时调用
     virtual void remove_bcb(BCB *bcb) = 0;
+    // page 被删除 (free_page) 时代替 remove_bcb 调用, 不留下 ghost 或历史, 以免之后复用该 page_id 的新 page 继承它们
+    virtual void discard_bcb(BCB *bcb) { remove_bcb(bcb); }
+    // 不在 replacer 中的 page 被删除时调用, 丢弃该 page_id 的 ghost 或历史
+    virtual void forget_page(int page_id) {}
     // 当某空 frame 关联新的 page 后调用, 并且算作一次 access
     virtual void insert_bcb(BCB *bcb, bool write) = 0;
-    virtual BCB *select_victim() const = 0;
+    // 当某空 frame 关联预取的 page 后调用, 不算作 access, 放在不影响热数据的位置;
+    // 之后第一次被访问时, BufferManager 先 remove_bcb 再 insert_bcb, 使其如同刚被换入
+    virtual void insert_prefetched(BCB *bcb) = 0;
+    // 选出下一个被换出的 BCB, 没有可换出的返回 nullptr. CLOCK 类算法在选择时移动指针、清除访问位, 故不是 const
+    virtual BCB *select_victim() = 0;
+    // select_victim 选出的 BCB 被 pin 住或暂时无法换出时调用, 将其移出可换出的范围, 不视为访问;
+    // 可以再次被换出时调用 unpark_bcb 放回. 被 park 的 BCB 不会被调用 access_frame 与 remove_bcb
+    virtual void park_bcb(BCB *bcb) = 0;
+    virtual void unpark_bcb(BCB *bcb) = 0;
+    // 按照将被换出的先后顺序 (最冷的在前) 向 out 追加至多 max 个 BCB, 供后台写回使用, 不改变替换算法的状态
+    virtual void scan_cold(std::vector<BCB *> &out, int max) const = 0;
 };
 
-class BufferManager {
+/**
+ * concurrent 为 true 时可以被多个线程同时使用:
+ * 1. 哈希表按 page_id 的哈希值分为 PTSHARDS 个分片, 每个分片一把锁, 保护分片内的 PageTable 与其中 BCB 的 count
+ * 2. replacer 与 m_ftop 由一把 replacer 锁保护, 且从不在持有分片锁时获取 replacer 锁 (可以在持有 replacer 锁时获取分片锁)
+ * 3. 换出时持有 replacer 锁的同时只 try_lock 被换出 page 的分片, 因而不会死锁
+ * 4. 读入 page 期间独占 BCB::latch, 命中的线程共享获取 latch 以等待读入完成
+ *
+ * 设置了 AsyncIo 后, page 通过它读入; 换出 dirty page 时若有备用 frame, 则异步写回被换出的 frame,
+ * 换入的 page 使用备用 frame, 写回与读入同时进行, 写回完成后被换出的 frame 成为新的备用 frame.
+ * 写回完成前该 page 记录在 m_writeback_pages 中, 再次读入它之前要等待写回完成.
+ *
+ * 并发模式下可以启动后台写回线程 (page cleaner), 它周期性地检查替换算法冷端的 frame 并提前写回其中 dirty 的,
+ * 使换出时尽量选到干净的 frame. 写回期间共享持有 BCB::latch, 换出时跳过正在写回的 frame.
+ *
+ * prefetch_page 预取 page 到缓冲区但不 pin 住它, 读入期间同样独占 BCB::latch. 并发模式下设置了 AsyncIo 时
+ * 预取是异步的, 在完成回调中插入 replacer; 否则同步读入. 设置了 readahead 后, fix_page 检测等步长的访问序列,
+ * 并预取其后的 readahead 个 page. 预取的 page 第一次被访问时计入 prefetch_hit_count.
+ *
+ * fix_pages 批量 fix 一组 page: 先处理全部命中的请求, 再为按 page_id 排序后的未命中 page 分配 frame,
+ * 相邻的 page 合并为一次 DataStorageManager::read_pages. 读入不经过 AsyncIo.
+ * flush_all 与之对称, 将 dirty 的 page 按 page_id 排序, 相邻的合并为一次 write_pages, 析构时也通过它写回.
+ *
+ * 以 SEQ_SCAN/BULK_WRITE 访问策略调用 fix_page 时, 未命中的 page 放入策略私有的 frame 环 (见 AccessStrategy),
+ * 环中的 frame 由 select_victim 从共享的缓冲区取得, 之后原地回收, 不进入 replacer, 也不触发顺序预读;
+ * m_ring_owner 记录每个 frame 所属的策略, 与 BCB::ringed 一同在 replacer 锁下修改.
+ *
+ * 设置了 CompressedCache 后, 换出的 page 在持有其分片锁时、写回 (若 dirty) 之前从 frame 压缩放入其中,
+ * 写回的正是同一 frame 的内容, 因而两者一致; 异步写回完成后 frame 会成为备用 frame, 不能在写回之后再读取它.
+ * 放入发生在从哈希表中移除之前, 因而其它线程在哈希表中找不到该 page 时, 它已经在压缩缓存中;
+ * 未命中 (包括预取与 fix_pages) 读文件之前先在其中查找.
+ *
+ * Policy 为替换算法的类型. BufferManager 即 BasicBufferManager<Replacer>, 按 algo 在运行时选择算法, 通过虚函数调用;
+ * Policy 为 replacers.h 中具体的 (final) 算法类时忽略 algo, 对替换算法的调用被静态分派并可以内联.
+ * 成员函数定义在 buffer_impl.h 中, 只对 Replacer 与各个算法类显式实例化.
+*/
+template <typename Policy>
+class BasicBufferManager {
 public:
-    BufferManager(DataStorageManager *dsmgr, Replacer::Algo algo);
+    BasicBufferManager(DataStorageManager *dsmgr, Replacer::Algo algo, int num_frames = DEFBUFSIZE, bool concurrent = false,
+        const ReplacerParams &params = ReplacerParams());
     // Interface fucntions
-    int fix_page(int page_id, bool write); // 0 for read, 1 for write
-    PageFrame fix_new_page();
+    // 0 for read, 1 for write, 所有 frame 都被 pin 住时返回 -1; strategy 为 nullptr 时与 NORMAL 相同
+    int fix_page(int page_id, bool write, AccessStrategy *strategy = nullptr);
+    int fix_pages(std::vector<PageRequest> &requests); // 返回失败的请求数, 成功的请求各自需要 unfix_page
+    // 写回所有 dirty 的 page, sync 为 true 时之后再 fsync 一次, 返回写回的 page 数
+    int flush_all(bool sync = false);
+    int checkpoint() { return flush_all(true); }
+    PageFrame fix_new_page(AccessStrategy *strategy = nullptr);
+    void release_strategy(AccessStrategy *strategy); // 换出环中未被 pin 住的 page, 其 frame 回到空闲栈中
+    int free_page(int page_id);
     int unfix_page(int page_id);
     int num_free_frames();
-    ~BufferManager();
-    int access_count;
-    int hit_count;
+    void set_async_io(AsyncIo *aio);
+    void set_compressed_cache(CompressedCache *cache) { m_tier2 = cache; } // nullptr 为不使用
+    int prefetch_page(int page_id); // 已在缓冲区中返回 0, 开始预取返回 1, 无法预取返回 -1
+    void set_readahead(int num_pages) { m_readahead = num_pages; } // 0 为不预读
+    // 启动后台写回线程, 仅可在并发模式下使用. 每轮检查冷端的 depth 个 frame, dirty 比例超过 dirty_target 时检查全部 frame,
+    // 每秒至多写回 max_pages_per_sec 个 page (0 为不限制)
+    void start_cleaner(double dirty_target, int depth, int max_pages_per_sec);
+    void stop_cleaner();
+    int get_num_frames() const { return m_num_frames; }
+    char *get_frame(int frame_id) { return m_frames + (size_t)frame_id * m_frame_size; }
+    ~BasicBufferManager();
+    std::atomic<int> access_count;
+    std::atomic<int> hit_count;
+    std::atomic<int> evict_count; // 换出的 page 数
+    std::atomic<int> dirty_evict_count; // 换出时需要写回的 page 数
+    std::atomic<int> clean_count; // 后台写回线程写回的 page 数
+    std::atomic<int> prefetch_count; // 预取读入的 page 数
+    std::atomic<int> prefetch_hit_count; // 命中中第一次访问预取的 page 的次数, 其余为 demand 命中
+    std::atomic<int> prefetch_unused_count; // 预取后未被访问就被换出的 page 数
+    std::atomic<int> batch_read_count; // fix_pages 合并后的读入次数
+    std::atomic<int> batch_page_count; // fix_pages 从文件读入的 page 数
+    std::atomic<int> tier2_hit_count; // 未命中但从压缩缓存中得到的 page 数, 即避免的读文件次数
+    std::atomic<int> ring_recycle_count; // 访问策略的环中原地回收的 frame 数
+    std::atomic<int> ring_write_count; // 其中需要写回的 frame 数
 private:
     // Internal Functions
     BCB *select_victim();
-    int hash(int page_id);
+    BCB *write_back_victim(BCB *bcb, int shard, ScopedLatch &replacer_latch);
+    void release_frame(BCB *bcb);
+    BCB *lookup(int shard, int page_id);
+    void access_hit(BCB *bcb, bool write);
+    BCB *ring_victim(AccessStrategy *strategy);
+    void add_to_ring(AccessStrategy *strategy, BCB *bcb);
+    BCB *evict_ring_frame(AccessStrategy *strategy, BCB *bcb);
+    void finish_prefetch(BCB *bcb);
+    void readahead(int page_id);
+    int hash(int page_id); // 得到 page 所在的分片
+    int read_frame(int page_id, int frame_id);
+    bool read_tier2(int page_id, int frame_id);
+    void finish_writeback(int page_id, int frame_id);
+    void wait_writeback(int page_id);
+    int write_frame(int page_id, int frame_id);
+    int clean_cold(int max_writes);
+    void cleaner_work();
     // void remove_bcb(BCB *ptr, int page_id); // 功能在 select_victim 内了
     // void remove_lru_file(int frid); // 功能在 replacer 实现
     void set_dirty(int frame_id);
     void unset_dirty(int frame_id);
-    void write_dirtys();
     void print_frame(int frame_id);
+    // Frames, 所有 frame 在构造时一次分配于连续的内存区域中, 最后 AIOSPARES 个 frame 开始时为备用 frame
+    int m_num_frames;
+    int m_total_frames; // m_num_frames + AIOSPARES
+    int m_frame_size;
+    char *m_frames;
     // Hash Table
-    int m_ftop[DEFBUFSIZE]; // frame_id 作为 index, 得到 page_id
-    BCB *m_ptof[DEFBUFSIZE]; // hash(page_id) 作为 index, 得到所在的 BCB 溢出链表
+    int *m_ftop; // frame_id 作为 index, 得到 page_id, -1 为空闲, -2 为已分配但尚未关联 page, -3 为备用
+    std::vector<int> m_free_frames; // m_ftop 为 -1 的 frame 构成的栈, 与 m_ftop 同由 replacer 锁保护
+    PageTable *m_ptof[PTSHARDS]; // hash(page_id) 作为 index, 得到所在分片的开放定址哈希表
+    BCB *m_bcbs; // frame_id 作为 index, 每个 frame 的 BCB 一直复用
     DataStorageManager *m_dsmgr;
-    Replacer *m_replacer;
+    Policy *m_replacer;
+    // Latches, 仅在并发模式下使用
+    bool m_concurrent;
+    std::mutex m_shard_latch[PTSHARDS]; // hash(page_id) 作为 index
+    std::mutex m_replacer_latch;
+    // 异步 I/O, 以下由 m_aio_latch 保护, 因为写回在完成线程中结束, 所以非并发模式下也要加锁
+    AsyncIo *m_aio;
+    std::mutex m_aio_latch;
+    std::condition_variable m_aio_cond;
+    std::deque<int> m_spare_frames;
+    std::vector<int> m_writeback_pages;
+    // 第二级压缩缓存
+    CompressedCache *m_tier2;
+    // 访问策略的环, frame_id 作为 index, 不属于任何环时为 nullptr, 由 replacer 锁保护
+    std::vector<AccessStrategy *> m_ring_owner;
+    // 后台写回
+    std::atomic<int> m_num_dirty;
+    std::thread m_cleaner;
+    std::mutex m_cleaner_latch;
+    std::condition_variable m_cleaner_cond;
+    bool m_cleaner_stop;
+    double m_cleaner_target;
+    int m_cleaner_depth;
+    int m_cleaner_rate;
+    // 顺序预读, 由 m_prefetch_latch 保护
+    int m_readahead;
+    std::mutex m_prefetch_latch;
+    int m_seq_last; // 上一次访问的 page
+    int m_seq_stride;
+    int m_seq_run; // 步长为 m_seq_stride 的连续访问次数
+    int m_seq_next; // 下一个尚未预取的 page
 };
+
+using BufferManager = BasicBufferManager<Replacer>;
+extern template class BasicBufferManager<Replacer>;
@@ -0,0 +1,985 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <type_traits>
+#include "buffer.h"
+
+/**
+ * BasicBufferManager 的成员函数定义, 只被需要显式实例化它的源文件包含
+*/
+
+char *alloc_frames(size_t size, size_t page_size); // 定义在 buffer.cpp 中
+
+// Replacer 按 algo 在运行时创建, 具体的算法类直接构造, 构造函数的参数按各个类的需要给出
+template <typename Policy>
+Policy *create_policy(Replacer::Algo algo, int num_frames, int capacity, const ReplacerParams &params)
+{
+    if constexpr (std::is_same<Policy, Replacer>::value) {
+        return Replacer::create(algo, num_frames, capacity, params);
+    } else if constexpr (std::is_constructible<Policy, int, int, const ReplacerParams &>::value) {
+        return new Policy {num_frames, capacity, params};
+    } else if constexpr (std::is_constructible<Policy, int, int>::value) {
+        return new Policy {num_frames, capacity};
+    } else if constexpr (std::is_constructible<Policy, int>::value) {
+        return new Policy {num_frames};
+    } else {
+        return new Policy;
+    }
+}
+
+template <typename Policy>
+BasicBufferManager<Policy>::BasicBufferManager(DataStorageManager *dsmgr, Replacer::Algo algo, int num_frames, bool concurrent,
+    const ReplacerParams &params)
+{
+    m_num_frames = num_frames;
+    m_total_frames = num_frames + AIOSPARES;
+    m_frame_size = dsmgr->get_page_size();
+    m_frames = alloc_frames((size_t)m_total_frames * m_frame_size, m_frame_size);
+    if (m_frames == nullptr) {
+        std::cerr << "error: failed to allocate " << num_frames << " frames" << std::endl;
+        exit(-1);
+    }
+    m_ftop = new int[m_total_frames];
+    memset(m_ftop, 0xffff, num_frames * sizeof(int)); // 全部设置为 -1
+    m_free_frames.reserve(num_frames);
+    for (int i = num_frames - 1; i >= 0; i--) { // 逆序压栈, 先分配 frame_id 小的
+        m_free_frames.push_back(i);
+    }
+    for (int i = num_frames; i < m_total_frames; i++) {
+        m_ftop[i] = -3;
+        m_spare_frames.push_back(i);
+    }
+    for (int i = 0; i < PTSHARDS; i++) {
+        m_ptof[i] = new PageTable {2 * num_frames / PTSHARDS};
+    }
+    m_bcbs = new BCB[m_total_frames];
+    for (int i = 0; i < m_total_frames; i++) {
+        m_bcbs[i].frame_id = i;
+    }
+    m_dsmgr = dsmgr;
+    m_replacer = create_policy<Policy>(algo, m_total_frames, m_num_frames, params); // 备用 frame 不与缓冲区同时驻留
+    m_concurrent = concurrent;
+    m_aio = nullptr;
+    m_tier2 = nullptr;
+    m_ring_owner.assign(m_total_frames, nullptr);
+    m_num_dirty = 0;
+    m_cleaner_stop = true;
+    access_count = hit_count = 0;
+    evict_count = dirty_evict_count = clean_count = 0;
+    prefetch_count = prefetch_hit_count = prefetch_unused_count = 0;
+    batch_read_count = batch_page_count = 0;
+    tier2_hit_count = 0;
+    ring_recycle_count = ring_write_count = 0;
+    m_readahead = 0;
+    m_seq_last = -1;
+    m_seq_stride = m_seq_run = m_seq_next = 0;
+}
+
+// 得到 page 对应的 frame_id, 可以认为是 requestor 在访问一次某 page
+template <typename Policy>
+int BasicBufferManager<Policy>::fix_page(int page_id, bool write, AccessStrategy *strategy)
+{
+    STATS_SCOPE(FIX_LATENCY);
+    STATS_INC(FIX);
+    access_count++;
+    bool ring = strategy != nullptr && strategy->get_kind() != AccessStrategy::NORMAL;
+    int shard = hash(page_id);
+    ScopedLatch shard_latch {m_shard_latch[shard], m_concurrent};
+    BCB *bcb = lookup(shard, page_id);
+    BCB *victim = nullptr;
+    if (bcb == nullptr) {
+        // 换出时不能持有分片锁, 换出后重新查找, 因为期间可能有其它线程换入了该 page
+        shard_latch.unlock();
+        victim = ring ? ring_victim(strategy) : select_victim();
+        if (victim == nullptr) {
+            return -1;
+        }
+        shard_latch.lock();
+        bcb = lookup(shard, page_id);
+    }
+    if (bcb != nullptr) {
+        hit_count++;
+        STATS_INC(HIT);
+        bcb->count++;
+        shard_latch.unlock();
+        if (victim != nullptr) {
+            release_frame(victim);
+        }
+        // 等待其它线程对该 frame 的读入完成
+        bcb->latch_shared();
+        bcb->unlatch_shared();
+        if (!ring) {
+            access_hit(bcb, write);
+        } else if (write) { // 访问策略的命中不通知 replacer
+            set_dirty(bcb->frame_id);
+        }
+    } else {
+        bcb = victim;
+        bcb->page_id = page_id;
+        bcb->count = 1;
+        bcb->latch_exclusive();
+        m_ptof[shard]->insert(page_id, bcb->frame_id);
+        shard_latch.unlock();
+        read_frame(page_id, bcb->frame_id);
+        {
+            ScopedLatch replacer_latch {m_replacer_latch, m_concurrent};
+            m_ftop[bcb->frame_id] = page_id;
+            if (!bcb->ringed) {
+                m_replacer->insert_bcb(bcb, write);
+            }
+        }
+        if (write) {
+            set_dirty(bcb->frame_id);
+        }
+        bcb->unlatch_exclusive();
+        STATS_INC(MISS);
+        STATS_RECORD_SCOPE(MISS_LATENCY);
+    }
+    if (m_readahead > 0 && !ring) {
+        readahead(page_id);
+    }
+    return bcb->frame_id;
+}
+
+// 批量 fix, 每个请求的访问统计与 fix_page 相同, 同一 page 的多个未命中请求只有第一个算作未命中.
+// 未命中的 page 在分配 frame 后独占 latch 直到全部读入完成, 因而分配期间发现已被其它线程换入的 page
+// 要等到读入完成、释放了这些 latch 之后再等待它的 latch, 以免两个批量请求互相等待
+template <typename Policy>
+int BasicBufferManager<Policy>::fix_pages(std::vector<PageRequest> &requests)
+{
+    std::vector<int> misses; // 未命中的请求下标
+    for (size_t i = 0; i < requests.size(); i++) {
+        PageRequest &request = requests[i];
+        access_count++;
+        STATS_INC(FIX);
+        int shard = hash(request.page_id);
+        ScopedLatch shard_latch {m_shard_latch[shard], m_concurrent};
+        BCB *bcb = lookup(shard, request.page_id);
+        if (bcb == nullptr) {
+            request.frame_id = -1;
+            misses.push_back((int)i);
+            continue;
+        }
+        hit_count++;
+        STATS_INC(HIT);
+        bcb->count++;
+        shard_latch.unlock();
+        bcb->latch_shared();
+        bcb->unlatch_shared();
+        access_hit(bcb, request.write);
+        request.frame_id = bcb->frame_id;
+    }
+    if (misses.empty()) {
+        return 0;
+    }
+    std::vector<int> order = misses; // 按请求顺序通知 replacer
+    std::stable_sort(misses.begin(), misses.end(), [&requests](int a, int b) {
+        return requests[a].page_id < requests[b].page_id;
+    });
+    std::vector<BCB *> loads; // 由本次读入的 BCB, page_id 升序
+    std::vector<int> waits; // 分配 frame 期间已被其它线程换入的请求
+    std::vector<char> loaded(requests.size(), 0);
+    int failed = 0;
+    for (size_t j = 0; j < misses.size(); ) {
+        int page_id = requests[misses[j]].page_id;
+        size_t end = j + 1;
+        while (end < misses.size() && requests[misses[end]].page_id == page_id) {
+            end++;
+        }
+        BCB *victim = select_victim();
+        if (victim == nullptr) {
+            failed += (int)(end - j);
+            j = end;
+            continue;
+        }
+        int shard = hash(page_id);
+        ScopedLatch shard_latch {m_shard_latch[shard], m_concurrent};
+        BCB *bcb = lookup(shard, page_id);
+        if (bcb != nullptr) {
+            bcb->count += (int)(end - j);
+            hit_count += (int)(end - j);
+            STATS_ADD(HIT, end - j);
+            shard_latch.unlock();
+            release_frame(victim);
+            for (size_t k = j; k < end; k++) {
+                requests[misses[k]].frame_id = bcb->frame_id;
+                waits.push_back(misses[k]);
+            }
+        } else {
+            victim->page_id = page_id;
+            victim->count = (int)(end - j);
+            victim->latch_exclusive();
+            m_ptof[shard]->insert(page_id, victim->frame_id);
+            shard_latch.unlock();
+            hit_count += (int)(end - j - 1);
+            STATS_ADD(HIT, end - j - 1);
+            STATS_INC(MISS);
+            loads.push_back(victim);
+            for (size_t k = j; k < end; k++) {
+                requests[misses[k]].frame_id = victim->frame_id;
+                loaded[misses[k]] = 1;
+            }
+        }
+        j = end;
+    }
+    // 压缩缓存中没有的 page 从文件读入, 相邻的合并为一次读入
+    std::vector<BCB *> reads;
+    for (BCB *bcb : loads) {
+        if (!read_tier2(bcb->page_id, bcb->frame_id)) {
+            reads.push_back(bcb);
+        }
+    }
+    std::vector<char *> frames;
+    for (size_t j = 0; j < reads.size(); ) {
+        size_t end = j + 1;
+        while (end < reads.size() && reads[end]->page_id == reads[end - 1]->page_id + 1) {
+            end++;
+        }
+        frames.clear();
+        for (size_t k = j; k < end; k++) {
+            if (m_aio != nullptr) {
+                wait_writeback(reads[k]->page_id);
+            }
+            frames.push_back(get_frame(reads[k]->frame_id));
+        }
+        m_dsmgr->read_pages(reads[j]->page_id, frames.data(), (int)(end - j));
+        batch_read_count++;
+        batch_page_count += (int)(end - j);
+        j = end;
+    }
+    {
+        ScopedLatch replacer_latch {m_replacer_latch, m_concurrent};
+        for (int i : order) {
+            if (!loaded[i]) {
+                continue;
+            }
+            BCB *bcb = &m_bcbs[requests[i].frame_id];
+            if (m_ftop[bcb->frame_id] == -2) { // 该 page 的第一个请求
+                m_ftop[bcb->frame_id] = bcb->page_id;
+                m_replacer->insert_bcb(bcb, requests[i].write);
+            } else {
+                m_replacer->access_frame(bcb, requests[i].write);
+            }
+            if (requests[i].write) {
+                set_dirty(bcb->frame_id);
+            }
+        }
+    }
+    for (BCB *bcb : loads) {
+        bcb->unlatch_exclusive();
+    }
+    for (int i : waits) {
+        BCB *bcb = &m_bcbs[requests[i].frame_id];
+        bcb->latch_shared();
+        bcb->unlatch_shared();
+        access_hit(bcb, requests[i].write);
+    }
+    return failed;
+}
+
+// 命中后通知 replacer, 预取的 page 第一次被访问时如同刚被换入
+// lock_free_access 的算法在既未被 park 也不是预取的 page 上命中时不需要 replacer 锁; 此后即使被 park,
+// 这些算法 park 时也不移动 BCB, 访问只是多设置了一次访问位
+template <typename Policy>
+void BasicBufferManager<Policy>::access_hit(BCB *bcb, bool write)
+{
+    if (m_replacer->lock_free_access() && !bcb->parked && !bcb->prefetched && !bcb->ringed) {
+        m_replacer->access_frame(bcb, write);
+        if (write) {
+            set_dirty(bcb->frame_id);
+        }
+        return;
+    }
+    ScopedLatch replacer_latch {m_replacer_latch, m_concurrent};
+    if (bcb->ringed) { // 访问策略的环中的 page 被普通访问命中, 移交给 replacer, 如同刚被换入
+        bcb->ringed = false;
+        m_ring_owner[bcb->frame_id] = nullptr;
+        m_replacer->insert_bcb(bcb, write);
+        if (write) {
+            set_dirty(bcb->frame_id);
+        }
+        return;
+    }
+    if (bcb->parked) { // 仍被其它调用者 pin 住, 放回后再访问, 之后被选中时会再次被 park
+        bcb->parked = false;
+        m_replacer->unpark_bcb(bcb);
+    }
+    if (bcb->prefetched) {
+        bcb->prefetched = false;
+        prefetch_hit_count++;
+        m_replacer->remove_bcb(bcb);
+        m_replacer->insert_bcb(bcb, write);
+    } else {
+        m_replacer->access_frame(bcb, write);
+    }
+    if (write) {
+        set_dirty(bcb->frame_id);
+    }
+}
+
+// 访问策略未命中时取得 frame: 环未满时从共享的缓冲区取得 frame 加入环, 否则按顺序回收环中下一个 frame;
+// 该 frame 已移交给 replacer 时, 以共享缓冲区中的新 frame 代替它在环中的位置
+template <typename Policy>
+BCB *BasicBufferManager<Policy>::ring_victim(AccessStrategy *strategy)
+{
+    std::vector<int> &frames = strategy->m_frames;
+    int ring_size = std::min(strategy->m_ring_size, std::max(m_num_frames / RINGSHARE, 1));
+    if ((int)frames.size() < ring_size) {
+        BCB *bcb = select_victim();
+        if (bcb != nullptr) {
+            frames.push_back(bcb->frame_id);
+            add_to_ring(strategy, bcb);
+        }
+        return bcb;
+    }
+    int slot = strategy->m_next % (int)frames.size();
+    strategy->m_next = (slot + 1) % (int)frames.size();
+    BCB *bcb = evict_ring_frame(strategy, &m_bcbs[frames[slot]]);
+    if (bcb != nullptr) {
+        frames[slot] = bcb->frame_id; // 异步写回时备用 frame 代替了原来的 frame
+        return bcb;
+    }
+    bcb = select_victim();
+    if (bcb == nullptr) {
+        frames.erase(frames.begin() + slot);
+        strategy->m_next = frames.empty() ? 0 : slot % (int)frames.size();
+        return nullptr;
+    }
+    frames[slot] = bcb->frame_id;
+    add_to_ring(strategy, bcb);
+    return bcb;
+}
+
+template <typename Policy>
+void BasicBufferManager<Policy>::add_to_ring(AccessStrategy *strategy, BCB *bcb)
+{
+    ScopedLatch replacer_latch {m_replacer_latch, m_concurrent};
+    bcb->ringed = true;
+    m_ring_owner[bcb->frame_id] = strategy;
+}
+
+// 换出环中的 frame, 与 select_victim 相同经由 write_back_victim 写回. 成功时返回留在环中的 frame, 在 m_ftop 中为 -2,
+// 异步写回时为代替它的备用 frame; frame 已不属于该环时返回 nullptr, 被 pin 住或正在写回时将其移交给 replacer
+// 并返回 nullptr. 移交的 page 只被访问策略访问过, 按预取的 page 放在冷端, 不视为访问, 以免扫描的 page 被提升
+template <typename Policy>
+BCB *BasicBufferManager<Policy>::evict_ring_frame(AccessStrategy *strategy, BCB *bcb)
+{
+    int frame_id = bcb->frame_id;
+    ScopedLatch replacer_latch {m_replacer_latch, m_concurrent};
+    if (m_ring_owner[frame_id] != strategy) {
+        return nullptr;
+    }
+    int page_id = m_ftop[frame_id];
+    if (page_id < 0) { // 尚未关联 page 或其 page 已被释放
+        return bcb;
+    }
+    int shard = hash(page_id);
+    ScopedLatch shard_latch {m_shard_latch[shard], m_concurrent};
+    if (bcb->count > 0 || bcb->latch != 0) {
+        bcb->ringed = false;
+        m_ring_owner[frame_id] = nullptr;
+        m_replacer->insert_prefetched(bcb);
+        return nullptr;
+    }
+    ring_recycle_count++;
+    if (bcb->dirty) {
+        ring_write_count++;
+    }
+    return write_back_victim(bcb, shard, replacer_latch);
+}
+
+template <typename Policy>
+void BasicBufferManager<Policy>::release_strategy(AccessStrategy *strategy)
+{
+    for (int frame_id : strategy->m_frames) {
+        BCB *bcb = evict_ring_frame(strategy, &m_bcbs[frame_id]);
+        if (bcb == nullptr) {
+            continue;
+        }
+        ScopedLatch replacer_latch {m_replacer_latch, m_concurrent};
+        bcb->ringed = false;
+        m_ring_owner[bcb->frame_id] = nullptr;
+        m_ftop[bcb->frame_id] = -1;
+        m_free_frames.push_back(bcb->frame_id);
+    }
+    strategy->m_frames.clear();
+    strategy->m_next = 0;
+}
+
+template <typename Policy>
+int BasicBufferManager<Policy>::prefetch_page(int page_id)
+{
+    if (page_id < 0 || page_id >= m_dsmgr->get_num_pages()) {
+        return -1;
+    }
+    int shard = hash(page_id);
+    {
+        ScopedLatch shard_latch {m_shard_latch[shard], m_concurrent};
+        if (lookup(shard, page_id) != nullptr) {
+            return 0;
+        }
+    }
+    BCB *bcb = select_victim();
+    if (bcb == nullptr) {
+        return -1;
+    }
+    {
+        ScopedLatch shard_latch {m_shard_latch[shard], m_concurrent};
+        if (lookup(shard, page_id) != nullptr) {
+            shard_latch.unlock();
+            release_frame(bcb);
+            return 0;
+        }
+        bcb->page_id = page_id;
+        bcb->count = 0;
+        bcb->latch_exclusive();
+        m_ptof[shard]->insert(page_id, bcb->frame_id);
+    }
+    prefetch_count++;
+    if (m_aio != nullptr && m_concurrent && !read_tier2(page_id, bcb->frame_id)) {
+        wait_writeback(page_id);
+        m_aio->submit_read(page_id, get_frame(bcb->frame_id), [this, bcb](int) {
+            finish_prefetch(bcb);
+        });
+    } else {
+        read_frame(page_id, bcb->frame_id);
+        finish_prefetch(bcb);
+    }
+    return 1;
+}
+
+// 预取读入完成, 异步预取时在 AsyncIo 的完成线程中调用
+template <typename Policy>
+void BasicBufferManager<Policy>::finish_prefetch(BCB *bcb)
+{
+    {
+        ScopedLatch replacer_latch {m_replacer_latch, m_concurrent};
+        m_ftop[bcb->frame_id] = bcb->page_id;
+        bcb->prefetched = true;
+        m_replacer->insert_prefetched(bcb);
+    }
+    bcb->unlatch_exclusive();
+}
+
+// 顺序预读: 连续 READAHEADTRIGGER 次访问的步长相同时, 预取之后 m_readahead 个步长内尚未预取的 page
+template <typename Policy>
+void BasicBufferManager<Policy>::readahead(int page_id)
+{
+    std::vector<int> pages;
+    {
+        ScopedLatch prefetch_latch {m_prefetch_latch, m_concurrent};
+        int stride = page_id - m_seq_last;
+        if (stride == 0) { // 重复访问同一个 page 不打断序列
+            return;
+        }
+        if (stride == m_seq_stride) {
+            m_seq_run++;
+        } else {
+            m_seq_stride = stride;
+            m_seq_run = 1;
+            m_seq_next = page_id + stride;
+        }
+        m_seq_last = page_id;
+        if (m_seq_run < READAHEADTRIGGER || std::abs(stride) > READAHEADMAXSTRIDE) {
+            return;
+        }
+        int first = std::max(1, (m_seq_next - page_id) / stride);
+        for (int i = first; i <= m_readahead; i++) {
+            pages.push_back(page_id + i * stride);
+        }
+        m_seq_next = page_id + std::max(first, m_readahead + 1) * stride;
+    }
+    for (int prefetch : pages) {
+        prefetch_page(prefetch);
+    }
+}
+
+// 创建新 page, 得到新 page 的 page_id 与 frame_id, 可以认为同时也写了此 page
+// 文件已达到 max_pages 时 page_id 与 frame_id 都为 -1
+template <typename Policy>
+PageFrame BasicBufferManager<Policy>::fix_new_page(AccessStrategy *strategy)
+{
+    int page_id = m_dsmgr->allocate_page();
+    if (page_id < 0) {
+        return {-1, -1};
+    }
+    int frame_id = fix_page(page_id, 1, strategy); // 新页一定要写的, 故为 1, 访问次数也在此统计
+    return {page_id, frame_id};
+}
+
+// 释放 page: 若在缓冲区中则直接丢弃其 frame (不写回), 之后在文件中标记为未使用. page 被 pin 住时返回 -1.
+// 替换算法不保留该 page 的 ghost 或历史, 文件复用该 page_id 时新 page 如同第一次被访问
+template <typename Policy>
+int BasicBufferManager<Policy>::free_page(int page_id)
+{
+    int shard = hash(page_id);
+    {
+        ScopedLatch replacer_latch {m_replacer_latch, m_concurrent};
+        ScopedLatch shard_latch {m_shard_latch[shard], m_concurrent};
+        BCB *bcb = lookup(shard, page_id);
+        if (bcb != nullptr && bcb->ringed) { // 留在环中, 环回收到它时直接复用
+            if (bcb->count > 0 || bcb->latch != 0) {
+                return -1;
+            }
+            unset_dirty(bcb->frame_id);
+            m_ptof[shard]->remove(page_id);
+            m_ftop[bcb->frame_id] = -2;
+        } else if (bcb != nullptr) {
+            if (bcb->count > 0 || bcb->latch != 0) {
+                return -1;
+            }
+            if (bcb->parked) { // 最后一次 unfix 尚未将其放回
+                bcb->parked = false;
+                m_replacer->unpark_bcb(bcb);
+            }
+            m_replacer->discard_bcb(bcb);
+            bcb->prefetched = false;
+            unset_dirty(bcb->frame_id);
+            m_ptof[shard]->remove(page_id);
+            m_ftop[bcb->frame_id] = -1;
+            m_free_frames.push_back(bcb->frame_id);
+        }
+        if (bcb == nullptr || bcb->ringed) { // 之前被换出过的 page 可能还有 ghost 或历史
+            m_replacer->forget_page(page_id);
+        }
+    }
+    if (m_tier2 != nullptr) {
+        m_tier2->erase(page_id);
+    }
+    return m_dsmgr->free_page(page_id);
+}
+
+// Requestor unpin a frame, 但是由于认为 fix_page 是一次访问, 所以在那时设置了 dirty
+template <typename Policy>
+int BasicBufferManager<Policy>::unfix_page(int page_id)
+{
+    int shard = hash(page_id);
+    ScopedLatch shard_latch {m_shard_latch[shard], m_concurrent};
+    BCB *bcb = lookup(shard, page_id);
+    if (bcb == nullptr) {
+        return -1;
+    }
+    // park 只在持有分片锁时看到 pin 才发生, 故此时能看到它; 放回需要 replacer 锁, 要先释放分片锁.
+    // 被 park 的 BCB 不会被换出, 期间若又被 fix, 由那次的 unfix 或命中时的访问放回
+    bool unpark = --bcb->count == 0 && bcb->parked;
+    shard_latch.unlock();
+    if (unpark) {
+        ScopedLatch replacer_latch {m_replacer_latch, m_concurrent};
+        if (bcb->parked && bcb->count == 0) {
+            bcb->parked = false;
+            m_replacer->unpark_bcb(bcb);
+        }
+    }
+    return bcb->frame_id;
+}
+
+template <typename Policy>
+int BasicBufferManager<Policy>::num_free_frames()
+{
+    ScopedLatch replacer_latch {m_replacer_latch, m_concurrent};
+    return (int)m_free_frames.size();
+}
+
+// 首先寻找有没有空闲的 frame, 如果没有就调用替换算法进行 select_victim, 并进行换出操作, 返回该 frame 的 BCB
+// 返回的 BCB 已不在哈希表与 replacer 中, 其 frame 在 m_ftop 中标记为 -2 (已分配但尚未关联 page)
+template <typename Policy>
+BCB *BasicBufferManager<Policy>::select_victim()
+{
+    ScopedLatch replacer_latch {m_replacer_latch, m_concurrent};
+    if (!m_free_frames.empty()) {
+        int frame_id = m_free_frames.back();
+        m_free_frames.pop_back();
+        m_ftop[frame_id] = -2;
+        return &m_bcbs[frame_id];
+    }
+    // 未找到, 则调用替换算法找到被替换的 frame, 并替换
+    // 替换算法可能选出被 pin 住的 frame, 此时将其 park, 在最后一次 unfix 时放回, 然后重新选择;
+    // 每次选择都会 park 一个 BCB, 因而至多选择 frame 数次, 替换算法返回 nullptr 时所有 frame 都被 pin 住
+    std::vector<BCB *> busy; // 暂时无法换出但未被 pin 住的, 选择结束时放回
+    auto unpark_busy = [this, &busy]() {
+        for (BCB *bcb : busy) {
+            bcb->parked = false;
+            m_replacer->unpark_bcb(bcb);
+        }
+    };
+    for (;;) {
+        BCB *bcb = m_replacer->select_victim();
+        STATS_INC(VICTIM);
+        if (bcb == nullptr) {
+            unpark_busy();
+            return nullptr;
+        }
+        int shard = hash(bcb->page_id);
+        ScopedLatch shard_latch {m_shard_latch[shard], m_concurrent, std::defer_lock};
+        // 后台写回线程正在写回的 frame 也暂时无法换出; 它在持有分片锁时获取 latch, 故此后不会再开始写回.
+        // 不能在持有 replacer 锁时等待写回, 因为写回可能要等 AsyncIo 的完成线程, 而它可能在等 replacer 锁
+        bool locked = shard_latch.try_lock();
+        if (!locked || bcb->count > 0 || bcb->latch != 0) {
+            bcb->parked = true;
+            m_replacer->park_bcb(bcb);
+            // 持有分片锁时看到的 pin 会在 unfix 时放回; 其余情况 (包括未取得分片锁) 在本次选择结束时放回
+            if (!locked || bcb->count == 0) {
+                busy.push_back(bcb);
+            }
+            continue;
+        }
+        unpark_busy();
+        m_replacer->remove_bcb(bcb);
+        evict_count++;
+        STATS_INC(EVICT);
+        if (bcb->prefetched) {
+            bcb->prefetched = false;
+            prefetch_unused_count++;
+        }
+        if (bcb->dirty) {
+            dirty_evict_count++;
+            STATS_INC(DIRTY_EVICT);
+        }
+        return write_back_victim(bcb, shard, replacer_latch);
+    }
+}
+
+// 换出已移出 replacer (或环) 的 bcb 的后半部分, select_victim 与 evict_ring_frame 共用: 调用时持有 replacer 锁
+// 与该 page 所在分片的锁. 压缩放入 CompressedCache, dirty 时写回, 设置了 AsyncIo 且有备用 frame 时异步写回,
+// 由备用 frame 代替它 (包括在环中的位置). 返回可以使用的 frame 的 BCB, 在 m_ftop 中为 -2; 返回时 replacer 锁已释放
+template <typename Policy>
+BCB *BasicBufferManager<Policy>::write_back_victim(BCB *bcb, int shard, ScopedLatch &replacer_latch)
+{
+    int frame_id = bcb->frame_id;
+    int spare = -1;
+    if (bcb->dirty && m_aio != nullptr) {
+        std::lock_guard<std::mutex> aio_latch {m_aio_latch};
+        if (!m_spare_frames.empty()) {
+            spare = m_spare_frames.front();
+            m_spare_frames.pop_front();
+            m_writeback_pages.push_back(bcb->page_id);
+        }
+    }
+    if (spare >= 0) {
+        m_ftop[frame_id] = -3;
+        m_ftop[spare] = -2;
+        if (bcb->ringed) {
+            m_bcbs[spare].ringed = true;
+            m_ring_owner[spare] = m_ring_owner[frame_id];
+            bcb->ringed = false;
+            m_ring_owner[frame_id] = nullptr;
+        }
+    } else {
+        m_ftop[frame_id] = -2;
+    }
+    replacer_latch.unlock();
+    // 写回期间仍持有该 page 所在分片的锁, 其它线程不会在写回完成前从磁盘读到旧的内容;
+    // 异步写回时该 page 已记录在 m_writeback_pages 中, 其它线程读入它前会等待写回完成
+    int page_id = bcb->page_id;
+    // 在写回之前压缩放入, 异步写回完成后 frame 即被复用
+    if (m_tier2 != nullptr) {
+        m_tier2->put(page_id, get_frame(frame_id));
+    }
+    if (spare >= 0) {
+        m_aio->submit_write(page_id, get_frame(frame_id), [this, page_id, frame_id](int) {
+            finish_writeback(page_id, frame_id);
+        });
+        unset_dirty(frame_id);
+        bcb = &m_bcbs[spare];
+    } else if (bcb->dirty) {
+        m_dsmgr->write_page(page_id, get_frame(frame_id));
+        unset_dirty(frame_id);
+    }
+    m_ptof[shard]->remove(page_id);
+    return bcb;
+}
+
+// 将 page 读入 frame, 设置了 AsyncIo 时通过它读入, 并且先等待该 page 可能在进行的写回
+template <typename Policy>
+int BasicBufferManager<Policy>::read_frame(int page_id, int frame_id)
+{
+    if (read_tier2(page_id, frame_id)) {
+        return 1;
+    }
+    if (m_aio == nullptr) {
+        return m_dsmgr->read_page(page_id, get_frame(frame_id));
+    }
+    wait_writeback(page_id);
+    return m_aio->wait(m_aio->submit_read(page_id, get_frame(frame_id)));
+}
+
+// 从压缩缓存中取得 page, 成功时不需要读文件
+template <typename Policy>
+bool BasicBufferManager<Policy>::read_tier2(int page_id, int frame_id)
+{
+    if (m_tier2 == nullptr || !m_tier2->get(page_id, get_frame(frame_id))) {
+        return false;
+    }
+    tier2_hit_count++;
+    return true;
+}
+
+// 异步写回完成, 在 AsyncIo 的完成线程中调用
+template <typename Policy>
+void BasicBufferManager<Policy>::finish_writeback(int page_id, int frame_id)
+{
+    {
+        std::lock_guard<std::mutex> aio_latch {m_aio_latch};
+        for (size_t i = 0; i < m_writeback_pages.size(); i++) {
+            if (m_writeback_pages[i] == page_id) {
+                m_writeback_pages[i] = m_writeback_pages.back();
+                m_writeback_pages.pop_back();
+                break;
+            }
+        }
+        m_spare_frames.push_back(frame_id);
+    }
+    m_aio_cond.notify_all();
+}
+
+template <typename Policy>
+void BasicBufferManager<Policy>::wait_writeback(int page_id)
+{
+    std::unique_lock<std::mutex> aio_latch {m_aio_latch};
+    m_aio_cond.wait(aio_latch, [this, page_id]() {
+        for (int writeback_page : m_writeback_pages) {
+            if (writeback_page == page_id) {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+template <typename Policy>
+void BasicBufferManager<Policy>::set_async_io(AsyncIo *aio)
+{
+    m_aio = aio;
+}
+
+// 归还 select_victim 得到但未使用的 frame, 环中的 frame 留在环中 (m_ftop 仍为 -2)
+template <typename Policy>
+void BasicBufferManager<Policy>::release_frame(BCB *bcb)
+{
+    ScopedLatch replacer_latch {m_replacer_latch, m_concurrent};
+    if (bcb->ringed) {
+        return;
+    }
+    m_ftop[bcb->frame_id] = -1;
+    m_free_frames.push_back(bcb->frame_id);
+}
+
+// 在分片内查找 page, 调用者需持有该分片的锁
+template <typename Policy>
+BCB *BasicBufferManager<Policy>::lookup(int shard, int page_id)
+{
+    int frame_id = m_ptof[shard]->find(page_id);
+    return frame_id < 0 ? nullptr : &m_bcbs[frame_id];
+}
+
+// 用哈希值的高位选择分片, 低位留给分片内的 PageTable 使用
+template <typename Policy>
+int BasicBufferManager<Policy>::hash(int page_id)
+{
+    return (PageTable::hash(page_id) >> 24) % PTSHARDS;
+}
+
+template <typename Policy>
+void BasicBufferManager<Policy>::set_dirty(int frame_id)
+{
+    if (m_bcbs[frame_id].dirty.exchange(1) == 0) {
+        m_num_dirty++;
+    }
+}
+
+template <typename Policy>
+void BasicBufferManager<Policy>::unset_dirty(int frame_id)
+{
+    if (m_bcbs[frame_id].dirty.exchange(0) == 1) {
+        m_num_dirty--;
+    }
+}
+
+// 写回所有 dirty 的 page: 在 replacer 锁下收集 dirty 的 frame 并按 page_id 排序, 之后同后台写回一样
+// 在分片锁下确认并共享获取 latch, 相邻 page 的一段 frame 都获取后一次写回. 可以与其它线程的访问并发执行,
+// 此时调用开始后才变为 dirty 的 page 不保证被写回
+template <typename Policy>
+int BasicBufferManager<Policy>::flush_all(bool sync)
+{
+    std::vector<PageFrame> dirtys;
+    {
+        ScopedLatch replacer_latch {m_replacer_latch, m_concurrent};
+        for (int i = 0; i < m_total_frames; i++) {
+            if (m_ftop[i] >= 0 && m_bcbs[i].dirty) {
+                dirtys.push_back({m_ftop[i], i});
+            }
+        }
+    }
+    std::sort(dirtys.begin(), dirtys.end(), [](const PageFrame &a, const PageFrame &b) {
+        return a.page_id < b.page_id;
+    });
+    std::vector<BCB *> run;
+    std::vector<const char *> frames;
+    int written = 0;
+    auto write_run = [this, &run, &frames, &written]() {
+        if (run.empty()) {
+            return;
+        }
+        frames.clear();
+        for (BCB *bcb : run) {
+            unset_dirty(bcb->frame_id);
+            frames.push_back(get_frame(bcb->frame_id));
+        }
+        m_dsmgr->write_pages(run[0]->page_id, frames.data(), (int)run.size());
+        for (BCB *bcb : run) {
+            bcb->unlatch_shared();
+        }
+        written += (int)run.size();
+        run.clear();
+    };
+    for (const PageFrame &dirty : dirtys) {
+        BCB *bcb = &m_bcbs[dirty.frame_id];
+        int shard = hash(dirty.page_id);
+        {
+            ScopedLatch shard_latch {m_shard_latch[shard], m_concurrent};
+            if (lookup(shard, dirty.page_id) != bcb || !bcb->dirty) {
+                continue;
+            }
+            bcb->latch_shared();
+        }
+        if (!run.empty() && run.back()->page_id + 1 != dirty.page_id) {
+            write_run();
+        }
+        run.push_back(bcb);
+    }
+    write_run();
+    if (sync) {
+        m_dsmgr->sync();
+    }
+    return written;
+}
+
+template <typename Policy>
+int BasicBufferManager<Policy>::write_frame(int page_id, int frame_id)
+{
+    if (m_aio == nullptr) {
+        return m_dsmgr->write_page(page_id, get_frame(frame_id));
+    }
+    return m_aio->wait(m_aio->submit_write(page_id, get_frame(frame_id)));
+}
+
+template <typename Policy>
+void BasicBufferManager<Policy>::start_cleaner(double dirty_target, int depth, int max_pages_per_sec)
+{
+    if (!m_concurrent || m_cleaner.joinable()) {
+        return;
+    }
+    m_cleaner_target = dirty_target;
+    m_cleaner_depth = depth;
+    m_cleaner_rate = max_pages_per_sec;
+    m_cleaner_stop = false;
+    m_cleaner = std::thread(&BasicBufferManager::cleaner_work, this);
+}
+
+template <typename Policy>
+void BasicBufferManager<Policy>::stop_cleaner()
+{
+    if (!m_cleaner.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> cleaner_latch {m_cleaner_latch};
+        m_cleaner_stop = true;
+    }
+    m_cleaner_cond.notify_all();
+    m_cleaner.join();
+}
+
+// 后台写回的一轮: 检查冷端的 frame, 写回其中至多 max_writes 个 dirty 的, 返回写回的 page 数
+template <typename Policy>
+int BasicBufferManager<Policy>::clean_cold(int max_writes)
+{
+    std::vector<BCB *> cold;
+    std::vector<int> pages;
+    {
+        ScopedLatch replacer_latch {m_replacer_latch, m_concurrent};
+        double dirty_ratio = (double)m_num_dirty / m_num_frames;
+        m_replacer->scan_cold(cold, dirty_ratio > m_cleaner_target ? m_num_frames : m_cleaner_depth);
+        // 在 replacer 中的 BCB 的 page_id 不会改变, 故在此时记录
+        for (BCB *bcb : cold) {
+            pages.push_back(bcb->page_id);
+        }
+    }
+    int written = 0;
+    for (size_t i = 0; i < cold.size() && written < max_writes; i++) {
+        BCB *bcb = cold[i];
+        if (!bcb->dirty) {
+            continue;
+        }
+        int shard = hash(pages[i]);
+        {
+            // 确认该 frame 仍是此 page, 并在持有分片锁时获取 latch, 使换出等待写回完成
+            ScopedLatch shard_latch {m_shard_latch[shard], m_concurrent};
+            if (lookup(shard, pages[i]) != bcb || !bcb->dirty) {
+                continue;
+            }
+            bcb->latch_shared();
+        }
+        // 先清除 dirty 再写回, 写回期间再次被写的 page 仍然是 dirty 的
+        unset_dirty(bcb->frame_id);
+        write_frame(pages[i], bcb->frame_id);
+        bcb->unlatch_shared();
+        clean_count++;
+        written++;
+    }
+    return written;
+}
+
+// 限速时按实际经过的时间累积写回额度 (令牌桶), 不足一个 page 的部分留到之后的轮次, 因而每秒少于
+// 1000 / CLEANINTERVAL 个 page 的速率也能生效; 额度至多累积 CLEANBURST 毫秒的量, 没有 dirty page 时不会攒下大量额度
+template <typename Policy>
+void BasicBufferManager<Policy>::cleaner_work()
+{
+    double credit = 0;
+    double burst = std::max(1.0, m_cleaner_rate * (double)CLEANBURST / 1000);
+    auto last = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> cleaner_latch {m_cleaner_latch};
+    while (!m_cleaner_stop) {
+        cleaner_latch.unlock();
+        int budget = m_num_frames;
+        if (m_cleaner_rate > 0) {
+            auto now = std::chrono::steady_clock::now();
+            credit = std::min(burst, credit + m_cleaner_rate * std::chrono::duration<double>(now - last).count());
+            last = now;
+            budget = (int)credit;
+        }
+        if (budget > 0) {
+            credit -= clean_cold(budget);
+        }
+        cleaner_latch.lock();
+        m_cleaner_cond.wait_for(cleaner_latch, std::chrono::milliseconds(CLEANINTERVAL), [this]() { return m_cleaner_stop; });
+    }
+}
+
+template <typename Policy>
+void BasicBufferManager<Policy>::print_frame(int frame_id)
+{
+    std::cout << get_frame(frame_id) << std::endl;
+}
+
+template <typename Policy>
+BasicBufferManager<Policy>::~BasicBufferManager()
+{
+    stop_cleaner();
+    if (m_aio != nullptr) {
+        m_aio->drain();
+    }
+    flush_all();
+    for (int i = 0; i < PTSHARDS; i++) {
+        delete m_ptof[i];
+    }
+    delete m_replacer;
+    delete[] m_bcbs;
+    delete[] m_ftop;
+    free(m_frames);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+
+#define LZMINMATCH 4 // 最短的匹配长度
+#define LZLASTLITERALS 5 // 块的最后至少有这么多字节作为字面量, 最后一个序列只有字面量
+#define LZMFLIMIT 12 // 距离块尾不足该长度的位置不再开始匹配
+#define LZHASHBITS 12
+#define TIER2OVERHEAD 64 // 每个条目除压缩数据外计入预算的字节数 (链表结点与哈希表项)
+
+/**
+ * LZ4 块格式的压缩与解压, 不包含帧格式与校验.
+ * 每个序列为: token (高 4 位字面量长度, 低 4 位匹配长度减 4, 15 表示之后还有长度字节),
+ * 字面量, 2 字节小端的匹配距离; 块的最后一个序列只有字面量. 匹配距离不超过 65535.
+ * lz_compress 在输出超过 capacity 时返回 -1, 否则返回压缩后的字节数;
+ * lz_decompress 在输入格式错误或输出超过 capacity 时返回 -1, 否则返回解压后的字节数
+*/
+int lz_compress(const char *src, int size, char *dst, int capacity);
+int lz_decompress(const char *src, int size, char *dst, int capacity);
+
+/**
+ * 被换出的 page 的压缩缓存 (第二级缓存)
+ *
+ * BufferManager 换出 page 时将其内容压缩后放入, 之后未命中时先在这里查找, 命中则解压到 frame 中,
+ * 不需要读文件. 缓存只保存与文件一致的内容 (dirty page 仍然照常写回), 因而可以随时丢弃条目.
+ * 命中的条目被移出 (page 回到缓冲区中, 再次换出时重新放入), 所以同一 page 不会同时在两级缓存中.
+ * 压缩数据与每个条目 TIER2OVERHEAD 字节的开销总和不超过 budget, 超过时按 LRU 淘汰;
+ * 压缩后仍不小于 page 大小 7/8 的 page 不放入. 所有接口都可以被多个线程同时调用, 压缩与解压在锁外进行.
+*/
+class CompressedCache {
+public:
+    CompressedCache(size_t budget, int page_size);
+    CompressedCache(const CompressedCache &) = delete;
+    CompressedCache &operator=(const CompressedCache &) = delete;
+    void put(int page_id, const char *page); // 已存在时替换
+    bool get(int page_id, char *page); // 命中时解压到 page 并移除该条目
+    void erase(int page_id);
+    size_t get_used() const { return m_used; }
+    void print_stats(std::ostream &out) const;
+    std::atomic<long long> put_count;
+    std::atomic<long long> reject_count; // 压缩效果不足而未放入的 page 数
+    std::atomic<long long> hit_count;
+    std::atomic<long long> miss_count;
+    std::atomic<long long> evict_count;
+private:
+    struct Entry {
+        int page_id;
+        int size;
+        std::unique_ptr<char[]> data;
+    };
+    void erase_locked(std::unordered_map<int, std::list<Entry>::iterator>::iterator it);
+
+    size_t m_budget;
+    int m_page_size;
+    std::mutex m_latch;
+    std::list<Entry> m_lru; // 头为最近放入的
+    std::unordered_map<int, std::list<Entry>::iterator> m_index;
+    std::atomic<size_t> m_used;
+    std::atomic<long long> m_raw_bytes; // 放入的 page 压缩前与压缩后的总字节数, 用于计算压缩率
+    std::atomic<long long> m_compressed_bytes;
+};
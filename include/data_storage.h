@@ -1,26 +1,110 @@
 #pragma once
 #include <string>
 #include <cstdio>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <sys/types.h>
 
-#define PAGESIZE 4096
-#define MAXPAGES 60000
+#define PAGESIZE 4096 // 默认的 page 大小
+#define MAXPAGES 60000 // 默认的文件最大 page 数
+#define STRIPEPAGES 64 // 默认的条带大小 (page 数)
+#define DIRECTALIGN 4096 // O_DIRECT 要求的内存与文件偏移对齐
+#define SPACEMAGIC "ADBSPAC2" // 文件头的魔数, 8 字节; 加入多文件信息后由 ADBSPACE 改为 ADBSPAC2
+#define SPACEMAGICV1 "ADBSPACE" // 单文件的旧文件头, 只有 max_pages 与 num_pages, 打开时原地升级
 
+/**
+ * 数据库由一组数据文件 (表空间) 组成, page 按条带分布在各文件中: 每 stripe_pages 个相邻的 page 为一个条带,
+ * 第 s 个条带位于第 s % num_files 个文件中的第 s / num_files 个条带位置. 只有一个文件时与单文件完全相同.
+ * 不同文件的读写互不阻塞, 文件增长时各文件轮流增长. read_pages/write_pages 在条带边界处拆分为多次系统调用.
+ *
+ * 提供四种文件访问方式:
+ * 1. STDIO: 通过 FILE* 的 fseek 与 fread/fwrite 读写, 同一文件的所有 page 共享同一个文件位置, 因而由该文件的锁串行化
+ * 2. PREAD: 在文件描述符上用 pread/pwrite 按位置读写, 不经过 stdio 缓冲, 可以被多个线程并发调用
+ * 3. DIRECT: 同 PREAD, 但以 O_DIRECT 打开, 绕过内核 page cache, 要求 frame 地址与 page 大小按 DIRECTALIGN 对齐
+ * 4. NONE: 不打开任何文件, 读写不访问 frame 的内容, 只计入 io_count, 供不需要真实 I/O 的模拟使用
+ *
+ * 第一个文件开头的若干个 header page 保存整个表空间的信息: 魔数, max_pages, num_pages, 文件数与条带大小,
+ * 之后是每个 page 一位的使用位图, 因而第一个文件中的 page 位于 header page 之后, 其它文件从头开始存放 page.
+ * header 在内存中常驻, 修改后只标记 dirty, 在 sync 与 close_file 时写回. 只有所有文件都为空时才格式化;
+ * 有内容但没有可识别文件头的文件 (包括最初没有文件头的格式) 打开失败, 以免丢失其中的 page.
+ * 已格式化的表空间沿用其文件头中的 max_pages 与条带大小, 文件数与文件头不一致时打开失败.
+ * 旧的 ADBSPACE 文件头作为单文件表空间原地升级: 保留位图, 条带大小取当前设置, 升级后的文件头立即写回.
+ * allocate_page 以 64 位为单位查找空闲位 (ctz), 并从上次分配的位置继续查找 (next fit);
+ * 所有 page 都在使用时直接扩展文件, 不需要查找.
+*/
 class DataStorageManager {
 public:
-    DataStorageManager();
-    int open_file(std::string filename);
-    int close_file();
+    enum IoMode {STDIO, PREAD, DIRECT, NONE};
+    DataStorageManager(int page_size = PAGESIZE, int max_pages = MAXPAGES);
+    ~DataStorageManager();
+    int open_file(std::string filename, IoMode mode = STDIO); // 只有一个文件的表空间
+    int open_files(const std::vector<std::string> &filenames, IoMode mode = STDIO); // 文件系统不支持 O_DIRECT 时退回 PREAD
+    int close_file(); // 关闭所有文件
+    void set_stripe_pages(int stripe_pages) { m_stripe_pages = stripe_pages; } // 在格式化新的表空间之前调用才有效
     int read_page(int page_id, char *frame);
     int write_page(int page_id, const char *frame);
+    // 将从 first_page_id 开始的 num_pages 个相邻 page 读入各自的 frame, 每次系统调用计为一次 I/O
+    int read_pages(int first_page_id, char *const *frames, int num_pages);
+    int write_pages(int first_page_id, const char *const *frames, int num_pages);
+    int sync(); // 将已写入的内容刷到磁盘, 成功返回 0
     int seek(int offset, int pos); // 实现但未使用
-    FILE *get_file();
-    void inc_num_pages();
+    FILE *get_file(); // 第一个文件
+    int get_fd() const { return m_files.empty() ? -1 : m_files[0]->fd; } // 第一个文件, 不使用文件描述符时为 -1
+    int page_fd(int page_id) const { return m_files.empty() ? -1 : m_files[file_index(page_id)]->fd; }
+    IoMode get_io_mode() const { return m_io_mode; }
+    int inc_num_pages(); // 文件已达到 max_pages 时返回 -1
     int get_num_pages();
+    int get_page_size() const { return m_page_size; }
+    int get_max_pages() const { return m_max_pages; }
+    int get_num_files() const { return m_num_files; }
+    int get_stripe_pages() const { return m_stripe_pages; }
+    int file_index(int page_id) const { return page_id / m_stripe_pages % m_num_files; }
+    off_t page_offset(int page_id) const; // 在 file_index 所指的文件中的偏移
+    int allocate_page(); // 返回一个空闲的 page 并标记为使用, 没有时扩展文件, 文件已达到 max_pages 时返回 -1
+    int free_page(int page_id); // page 不在使用时返回 -1
     void set_use(int index, int use_bit);
     int get_use(int index);
-    int io_count;
+    std::atomic<int> io_count;
 private:
-    FILE *m_curr_file;
+    struct SpaceHeader {
+        char magic[8];
+        int32_t max_pages;
+        int32_t num_pages;
+        int32_t num_files;
+        int32_t stripe_pages;
+    };
+    struct DataFile {
+        FILE *file;
+        int fd;
+        std::mutex latch; // STDIO 方式下串行化该文件的 fseek 与读写
+    };
+    void format();
+    int load_header();
+    int upgrade_header(const char *first);
+    int read_header(char *buffer, size_t size);
+    int write_header();
+    int extend_locked();
+    int run_length(int page_id, int num_pages) const; // 从 page_id 开始在同一文件中连续的 page 数, 不超过 num_pages 与 IOV_MAX
+    int open_one(const std::string &filename, IoMode mode);
+    void close_all();
+    void set_use_locked(int index, int use_bit);
+    uint64_t *bitmap() { return reinterpret_cast<uint64_t *>(m_header + sizeof(SpaceHeader)); }
+
+    IoMode m_io_mode;
+    std::vector<DataFile *> m_files; // NONE 方式下为空
+    int m_num_files;
+    int m_stripe_pages;
+    int m_page_size;
+    int m_max_pages;
     int m_num_pages;
-    int m_pages[MAXPAGES];
-};
\ No newline at end of file
+    char *m_page_default_content; // 按 DIRECTALIGN 对齐的全 0 page
+    // 空间管理, 由 m_space_latch 保护
+    std::mutex m_space_latch;
+    int m_header_pages;
+    char *m_header; // 按 DIRECTALIGN 对齐, SpaceHeader 之后为位图
+    std::vector<char> m_header_dirty; // 每个 header page 是否需要写回
+    int m_num_used;
+    int m_alloc_hint; // 下一次分配开始查找的位图字下标
+};
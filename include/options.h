@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "buffer.h"
+
+/**
+ * 命令行选项的解析, 由 adblab 与基准测试共用
+*/
+
+// 按逗号分隔的列表
+std::vector<std::string> split_list(const std::string &text);
+// 替换算法的名字 (lru, mru, random, clock, lru-2, 2q, lru-k, arc, car, clock-pro), 不认识时返回 false
+bool parse_algo(const std::string &algo_name, Replacer::Algo &algo);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * page_id 到 frame_id 的开放定址哈希表
+ *
+ * 采用线性探测, 槽位为连续的 (page_id, frame_id) 数组, 一次查找只有一条探测序列, 没有指针跳转;
+ * 删除时将后续槽位向前移动 (backward shift), 因而不需要墓碑. 容量为 2 的幂, 与 frame 数量无关,
+ * 装载因子超过 1/2 时自动扩容. 本身不加锁, 并发模式下由 BufferManager 按分片加锁.
+*/
+class PageTable {
+public:
+    explicit PageTable(int capacity);
+    ~PageTable();
+    PageTable(const PageTable &) = delete;
+    PageTable &operator=(const PageTable &) = delete;
+    // 返回 page 所在的 frame_id, 不存在时返回 -1
+    int find(int page_id) const;
+    void insert(int page_id, int frame_id);
+    // 返回是否删除成功
+    bool remove(int page_id);
+    int size() const { return m_size; }
+    int capacity() const { return (int)m_mask + 1; }
+    // 混合各个二进制位的哈希函数 (murmur3 的 fmix32), 连续的 page_id 会被打散
+    static uint32_t hash(int page_id) {
+        uint32_t h = (uint32_t)page_id;
+        h ^= h >> 16;
+        h *= 0x85ebca6b;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35;
+        h ^= h >> 16;
+        return h;
+    }
+private:
+    struct Slot {
+        int page_id; // -1 表示空槽位
+        int frame_id;
+    };
+    void grow();
+    Slot *m_slots;
+    uint32_t m_mask;
+    int m_size;
+};
@@ -0,0 +1,1291 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "buffer.h"
+
+/**
+ * 各个替换算法的实现
+ *
+ * Replacer::create 在运行时选择算法, 通过虚函数调用; 算法类都是 final 的, 以它们为参数实例化的
+ * BasicBufferManager<Policy> 中的调用可以被静态分派并内联. 所有成员函数都定义在类内.
+*/
+
+// BCB 通过 32 位的 frame_id 链接成双向链表, 只保存头尾指针
+class LinkedList {
+public:
+    BCB *head, *tail;
+    LinkedList(): head(nullptr), tail(nullptr) {}
+    void insert_tail(BCB *bcb) {
+        bcb->set_next(nullptr);
+        bcb->set_prev(tail);
+        if (tail != nullptr) {
+            tail->set_next(bcb);
+            tail = bcb;
+        } else {
+            head = tail = bcb;
+        }
+    }
+    void insert_head(BCB *bcb) {
+        bcb->set_prev(nullptr);
+        bcb->set_next(head);
+        if (head != nullptr) {
+            head->set_prev(bcb);
+            head = bcb;
+        } else {
+            head = tail = bcb;
+        }
+    }
+    void remove(BCB *bcb) {
+        BCB *prev = bcb->prev(), *next = bcb->next();
+        if (prev) {
+            prev->set_next(next);
+        } else {
+            head = next;
+        }
+        if (next) {
+            next->set_prev(prev);
+        } else {
+            tail = prev;
+        }
+        bcb->set_next(nullptr);
+        bcb->set_prev(nullptr);
+    }
+    // 从 head (reverse 时为 tail) 开始向 out 追加, 直到 out 中有 max 个
+    void collect(std::vector<BCB *> &out, int max, bool reverse = false) const {
+        for (BCB *p = reverse ? tail : head; p != nullptr && (int)out.size() < max; p = reverse ? p->prev() : p->next()) {
+            out.push_back(p);
+        }
+    }
+};
+
+// 被换出的 page 的 LRU 链表, 只记录 page_id, 用哈希表定位
+class GhostList {
+public:
+    int size() const {
+        return (int)order.size();
+    }
+    bool contains(int page_id) const {
+        return index.count(page_id) != 0;
+    }
+    void push_mru(int page_id) {
+        order.push_back(page_id);
+        index[page_id] = std::prev(order.end());
+    }
+    void remove(int page_id) {
+        auto it = index.find(page_id);
+        order.erase(it->second);
+        index.erase(it);
+    }
+    void pop_lru() {
+        index.erase(order.front());
+        order.pop_front();
+    }
+private:
+    std::list<int> order; // 头为 LRU
+    std::unordered_map<int, std::list<int>::iterator> index;
+};
+
+// 这里实现的替换算法不检查 pin-count, 被选中但被 pin 住的 BCB 由 BufferManager 通过 park_bcb 移出可换出的范围,
+// 因而 select_victim 不会反复选中同一个被 pin 住的 BCB
+
+// LRU 与 MRU 共用的链表, 两者只是换出的一端不同
+class ListReplacer: public Replacer {
+public:
+    ListReplacer(): list() {}
+    ~ListReplacer() override {}
+    void access_frame(BCB *bcb, bool write) override {
+        list.remove(bcb);
+        list.insert_tail(bcb);
+    }
+    void remove_bcb(BCB *bcb) override {
+        list.remove(bcb);
+    }
+    void insert_bcb(BCB *bcb, bool write) override {
+        list.insert_tail(bcb);
+    }
+    void park_bcb(BCB *bcb) override {
+        list.remove(bcb);
+    }
+    // 被 pin 期间一直在使用, 放回最近访问的一端
+    void unpark_bcb(BCB *bcb) override {
+        list.insert_tail(bcb);
+    }
+    // LRU 没有单独的冷区, 放在队头会被紧接着的预取换出, 故与普通换入相同
+    void insert_prefetched(BCB *bcb) override {
+        list.insert_tail(bcb);
+    }
+    BCB *select_victim() override {
+        return list.head;
+    }
+    void scan_cold(std::vector<BCB *> &out, int max) const override {
+        list.collect(out, max);
+    }
+protected:
+    LinkedList list; // head is lru, tail is mru
+};
+
+class LruReplacer final: public ListReplacer {
+public:
+    Algo get_algo() const override {
+        return Algo::LRU;
+    }
+};
+
+class MruReplacer final: public ListReplacer {
+public:
+    Algo get_algo() const override {
+        return Algo::MRU;
+    }
+    // MRU 从队尾换出, 预取的 page 放在队头, 避免在被访问前就被换出
+    void insert_prefetched(BCB *bcb) override {
+        list.insert_head(bcb);
+    }
+    BCB *select_victim() override {
+        return list.tail;
+    }
+    void scan_cold(std::vector<BCB *> &out, int max) const override {
+        list.collect(out, max, true);
+    }
+};
+
+// 可换出的 BCB 紧密排列在 m_frame_table 中, 移除时与最后一个交换, 因而总是从可换出的 BCB 中均匀选择
+class RandomReplacer final: public Replacer {
+public:
+    RandomReplacer(int num_frames): m_frame_table(), m_index(num_frames, -1) {
+        srand((unsigned int)time(nullptr));
+    }
+    ~RandomReplacer() override {}
+    Algo get_algo() const override {
+        return Algo::RANDOM;
+    }
+    void access_frame(BCB *bcb, bool write) override {}
+    void remove_bcb(BCB *bcb) override {
+        int i = m_index[bcb->frame_id];
+        m_frame_table[i] = m_frame_table.back();
+        m_index[m_frame_table[i]->frame_id] = i;
+        m_frame_table.pop_back();
+        m_index[bcb->frame_id] = -1;
+    }
+    void insert_bcb(BCB *bcb, bool write) override {
+        m_index[bcb->frame_id] = (int)m_frame_table.size();
+        m_frame_table.push_back(bcb);
+    }
+    void insert_prefetched(BCB *bcb) override {
+        insert_bcb(bcb, false);
+    }
+    void park_bcb(BCB *bcb) override {
+        remove_bcb(bcb);
+    }
+    void unpark_bcb(BCB *bcb) override {
+        insert_bcb(bcb, false);
+    }
+    BCB *select_victim() override {
+        int num_frames = (int)m_frame_table.size();
+        if (num_frames == 0) {
+            return nullptr;
+        }
+        int i = (int)((double)rand() / RAND_MAX * num_frames) % num_frames;
+        return m_frame_table[i];
+    }
+    // 随机替换没有冷热之分, 从一个随机位置开始依次返回
+    void scan_cold(std::vector<BCB *> &out, int max) const override {
+        int num_frames = (int)m_frame_table.size();
+        int start = num_frames > 0 ? rand() % num_frames : 0;
+        for (int i = 0; i < num_frames && (int)out.size() < max; i++) {
+            out.push_back(m_frame_table[(start + i) % num_frames]);
+        }
+    }
+private:
+    // std::mt19937 m_gen;
+    std::vector<BCB *> m_frame_table;
+    std::vector<int> m_index; // frame_id 作为 index, 在 m_frame_table 中的下标, -1 为不在其中
+};
+
+// CLOCK: 环由 replacer 持有, 按 frame_id 覆盖所有 frame, 不依赖 frame 被使用的先后顺序, 不在替换范围内的位置被指针跳过.
+// 访问位为原子变量, access_frame 只设置访问位, 因而可以不持有 replacer 锁而与 select_victim 同时调用
+class ClockReplacer final: public Replacer {
+public:
+    ClockReplacer(int num_frames): ring(num_frames, nullptr), state(num_frames, EMPTY),
+        referenced(new std::atomic<char>[num_frames]), hand(0) {
+        for (int i = 0; i < num_frames; i++) {
+            referenced[i] = 0;
+        }
+    }
+    ~ClockReplacer() override {}
+    Algo get_algo() const override {
+        return Algo::CLOCK;
+    }
+    bool lock_free_access() const override {
+        return true;
+    }
+    void access_frame(BCB *bcb, bool write) override {
+        referenced[bcb->frame_id] = 1;
+    }
+    void remove_bcb(BCB *bcb) override {
+        ring[bcb->frame_id] = nullptr;
+        state[bcb->frame_id] = EMPTY;
+    }
+    void insert_bcb(BCB *bcb, bool write) override {
+        ring[bcb->frame_id] = bcb;
+        state[bcb->frame_id] = RESIDENT;
+        referenced[bcb->frame_id] = 1;
+    }
+    // 预取的 page 不设置访问位, 指针第一次经过时即可被换出
+    void insert_prefetched(BCB *bcb) override {
+        insert_bcb(bcb, false);
+        referenced[bcb->frame_id] = 0;
+    }
+    // 被 pin 住的留在环中但被指针跳过, 放回时视为被访问过
+    void park_bcb(BCB *bcb) override {
+        state[bcb->frame_id] = PARKED;
+    }
+    void unpark_bcb(BCB *bcb) override {
+        state[bcb->frame_id] = RESIDENT;
+        referenced[bcb->frame_id] = 1;
+    }
+    // 转两圈仍找不到 (全部被 pin 住或不在替换范围内) 则放弃
+    BCB *select_victim() override {
+        int n = (int)ring.size();
+        for (int steps = 0; steps < 2 * n; steps++) {
+            STATS_INC(SCAN);
+            int frame_id = hand;
+            hand = (hand + 1) % n;
+            if (state[frame_id] == RESIDENT && !referenced[frame_id].exchange(0)) {
+                return ring[frame_id];
+            }
+        }
+        return nullptr;
+    }
+    // 按指针将要经过的顺序返回, 未被访问过的更早被换出, 因而排在前面
+    void scan_cold(std::vector<BCB *> &out, int max) const override {
+        int n = (int)ring.size();
+        for (char bit = 0; bit <= 1; bit++) {
+            for (int i = 0; i < n && (int)out.size() < max; i++) {
+                int frame_id = (hand + i) % n;
+                if (state[frame_id] == RESIDENT && referenced[frame_id] == bit) {
+                    out.push_back(ring[frame_id]);
+                }
+            }
+        }
+    }
+private:
+    enum State: char {EMPTY, RESIDENT, PARKED};
+    std::vector<BCB *> ring; // frame_id 作为 index
+    std::vector<State> state;
+    std::unique_ptr<std::atomic<char>[]> referenced;
+    int hand;
+};
+
+// CLOCK-Pro (Jiang, Chen, Zhang, USENIX ATC 2005): 在一个环上按重用距离把驻留的 page 分为 hot 与 cold.
+// 新换入的 page 为 cold 并进入 test period, 期间再次被访问则变为 hot; 在 test period 内被换出的 cold page 作为非驻留 page
+// 留在环上, 在 test period 结束前再次换入时直接成为 hot, 因而一次性的扫描只会经过 cold page 而不会冲掉 hot page.
+// 三个指针沿同一方向移动: hand_cold 寻找被换出的 cold page, hand_hot 将访问位为 0 的 hot page 降为 cold,
+// hand_test 在非驻留 page 过多时结束 test period 并移除非驻留 page. cold page 的目标数量 cold_target 在 test period 内
+// 有再次访问时增大, test period 无访问地结束时减小. 新结点插在 hand_hot 之前, 即环的头部.
+// 环由 replacer 持有的结点组成, 结点在驻留期间不会改变, 访问位同 CLOCK 为原子变量, access_frame 可以不持有 replacer 锁
+class ClockProReplacer final: public Replacer {
+public:
+    ClockProReplacer(int num_frames, int capacity): capacity(std::max(2, capacity)), nodes(2 * num_frames + 2), frame_node(num_frames, -1),
+        ring_size(0), hand_cold(-1), hand_hot(-1), hand_test(-1), num_hot(0), num_cold(0), num_cold_parked(0),
+        num_nonresident(0), cold_target(std::max(1, capacity / 100)) {
+        for (int i = (int)nodes.size() - 1; i >= 0; i--) {
+            free_nodes.push_back(i);
+        }
+    }
+    ~ClockProReplacer() override {}
+    Algo get_algo() const override {
+        return Algo::CLOCK_PRO;
+    }
+    bool lock_free_access() const override {
+        return true;
+    }
+    void access_frame(BCB *bcb, bool write) override {
+        nodes[frame_node[bcb->frame_id]].referenced = 1;
+    }
+    // 仍在 test period 的 cold page 成为非驻留 page, 其余的离开环
+    void remove_bcb(BCB *bcb) override {
+        int n = frame_node[bcb->frame_id];
+        Node &node = nodes[n];
+        if (node.hot || !node.test) {
+            discard_bcb(bcb);
+            return;
+        }
+        frame_node[bcb->frame_id] = -1;
+        num_cold--;
+        node.bcb = nullptr;
+        ghosts[node.page_id] = n;
+        num_nonresident++;
+        while (num_nonresident > capacity) {
+            run_hand_test();
+        }
+    }
+    // 被删除的 page 直接离开环, 不成为非驻留 page
+    void discard_bcb(BCB *bcb) override {
+        int n = frame_node[bcb->frame_id];
+        frame_node[bcb->frame_id] = -1;
+        if (nodes[n].hot) {
+            num_hot--;
+        } else {
+            num_cold--;
+        }
+        release(n);
+    }
+    void forget_page(int page_id) override {
+        auto it = ghosts.find(page_id);
+        if (it == ghosts.end()) {
+            return;
+        }
+        int n = it->second;
+        ghosts.erase(it);
+        num_nonresident--;
+        release(n);
+    }
+    void insert_bcb(BCB *bcb, bool write) override {
+        auto it = ghosts.find(bcb->page_id);
+        if (it == ghosts.end()) {
+            insert(bcb, false, true);
+            return;
+        }
+        // 在 test period 内再次换入, 说明 cold page 的空间不足
+        cold_target = std::min(cold_target + 1, capacity - 1);
+        int n = it->second;
+        ghosts.erase(it);
+        num_nonresident--;
+        unlink(n);
+        free_nodes.push_back(n);
+        insert(bcb, true, false);
+        balance_hot();
+    }
+    // 预取的 page 为不在 test period 的 cold page, 未被访问就被换出时不留下非驻留 page
+    void insert_prefetched(BCB *bcb) override {
+        insert(bcb, false, false);
+    }
+    void park_bcb(BCB *bcb) override {
+        Node &node = nodes[frame_node[bcb->frame_id]];
+        node.parked = true;
+        if (!node.hot) {
+            num_cold_parked++;
+        }
+    }
+    void unpark_bcb(BCB *bcb) override {
+        Node &node = nodes[frame_node[bcb->frame_id]];
+        node.parked = false;
+        node.referenced = 1;
+        if (!node.hot) {
+            num_cold_parked--;
+        }
+    }
+    BCB *select_victim() override {
+        for (int steps = 0; steps < 4 * ring_size + 4; steps++) {
+            STATS_INC(SCAN);
+            // 没有可换出的 cold page 时先将一个 hot page 降为 cold
+            if (num_cold - num_cold_parked <= 0 && !run_hand_hot()) {
+                return nullptr;
+            }
+            int n = hand_cold;
+            Node &node = nodes[n];
+            if (node.hot || node.bcb == nullptr || node.parked) {
+                hand_cold = node.next;
+                continue;
+            }
+            if (!node.referenced.exchange(0)) {
+                return node.bcb; // hand_cold 停在此处, 被换出后由 remove_bcb 移动
+            }
+            if (node.test) { // 在 test period 内被访问, 成为 hot
+                node.hot = true;
+                node.test = false;
+                num_cold--;
+                num_hot++;
+                cold_target = std::min(cold_target + 1, capacity - 1);
+                move_to_head(n);
+                balance_hot();
+            } else { // 开始新的 test period
+                node.test = true;
+                move_to_head(n);
+            }
+        }
+        return nullptr;
+    }
+    // 从 hand_cold 开始, 先返回访问位为 0 的 cold page, 再返回访问位为 1 的
+    void scan_cold(std::vector<BCB *> &out, int max) const override {
+        for (char bit = 0; bit <= 1; bit++) {
+            int n = hand_cold;
+            for (int i = 0; i < ring_size && (int)out.size() < max; i++, n = nodes[n].next) {
+                const Node &node = nodes[n];
+                if (!node.hot && node.bcb != nullptr && !node.parked && node.referenced == bit) {
+                    out.push_back(node.bcb);
+                }
+            }
+        }
+    }
+private:
+    struct Node {
+        int prev, next;
+        int page_id;
+        BCB *bcb; // nullptr 为非驻留
+        bool hot;
+        bool test; // 是否在 test period 内
+        bool parked;
+        std::atomic<char> referenced;
+    };
+    void insert(BCB *bcb, bool hot, bool test) {
+        int n = free_nodes.back();
+        free_nodes.pop_back();
+        Node &node = nodes[n];
+        node.page_id = bcb->page_id;
+        node.bcb = bcb;
+        node.hot = hot;
+        node.test = test;
+        node.parked = false;
+        node.referenced = 0;
+        frame_node[bcb->frame_id] = n;
+        link_head(n);
+        if (hot) {
+            num_hot++;
+        } else {
+            num_cold++;
+        }
+    }
+    void release(int n) {
+        unlink(n);
+        free_nodes.push_back(n);
+    }
+    void link_head(int n) {
+        if (ring_size++ == 0) {
+            nodes[n].prev = nodes[n].next = n;
+            hand_cold = hand_hot = hand_test = n;
+            return;
+        }
+        int next = hand_hot, prev = nodes[next].prev;
+        nodes[n].prev = prev;
+        nodes[n].next = next;
+        nodes[prev].next = n;
+        nodes[next].prev = n;
+    }
+    // 指向被移除结点的指针移到下一个结点
+    void unlink(int n) {
+        if (--ring_size == 0) {
+            hand_cold = hand_hot = hand_test = -1;
+            return;
+        }
+        int prev = nodes[n].prev, next = nodes[n].next;
+        nodes[prev].next = next;
+        nodes[next].prev = prev;
+        for (int *hand : {&hand_cold, &hand_hot, &hand_test}) {
+            if (*hand == n) {
+                *hand = next;
+            }
+        }
+    }
+    void move_to_head(int n) {
+        unlink(n);
+        link_head(n);
+    }
+    // 结束 cold page 的 test period, 非驻留的随之离开环, 返回是否离开了环
+    bool end_test(int n) {
+        Node &node = nodes[n];
+        node.test = false;
+        cold_target = std::max(cold_target - 1, 1);
+        if (node.bcb != nullptr) {
+            return false;
+        }
+        ghosts.erase(node.page_id);
+        num_nonresident--;
+        release(n);
+        return true;
+    }
+    void balance_hot() {
+        while (num_hot > capacity - cold_target && run_hand_hot()) {
+        }
+    }
+    // 将 hand_hot 遇到的第一个访问位为 0 且未被 pin 住的 hot page 降为 cold, 经过的 cold page 结束 test period
+    bool run_hand_hot() {
+        for (int steps = 0; steps < 2 * ring_size + 2 && hand_hot >= 0; steps++) {
+            STATS_INC(SCAN);
+            int n = hand_hot;
+            Node &node = nodes[n];
+            if (node.hot) {
+                if (!node.parked && !node.referenced.exchange(0)) {
+                    node.hot = false;
+                    num_hot--;
+                    num_cold++;
+                    hand_hot = node.next;
+                    return true;
+                }
+            } else if (node.test && end_test(n)) {
+                continue; // hand_hot 已移到下一个结点
+            }
+            hand_hot = node.next;
+        }
+        return false;
+    }
+    // 移除 hand_test 遇到的第一个非驻留 page, 经过的驻留 cold page 结束 test period
+    void run_hand_test() {
+        for (int steps = 0; steps < ring_size + 1 && hand_test >= 0; steps++) {
+            STATS_INC(SCAN);
+            int n = hand_test;
+            Node &node = nodes[n];
+            if (!node.hot && node.test) {
+                bool nonresident = node.bcb == nullptr;
+                if (end_test(n) || nonresident) {
+                    return;
+                }
+            }
+            hand_test = node.next;
+        }
+    }
+
+    int capacity;
+    std::vector<Node> nodes;
+    std::vector<int> free_nodes;
+    std::vector<int> frame_node; // frame_id 作为 index, 得到驻留 page 的结点
+    std::unordered_map<int, int> ghosts; // 非驻留 page 的 page_id 到结点
+    int ring_size;
+    int hand_cold, hand_hot, hand_test;
+    int num_hot, num_cold, num_cold_parked, num_nonresident;
+    int cold_target;
+};
+
+class Lru2Replacer final: public Replacer {
+public:
+    Lru2Replacer(int num_frames, int capacity): lru(), prefetched(), num_prefetched(0), max_prefetched(capacity / PREFETCHSHARE), sorted(), time(0),
+        times(num_frames) {}
+    ~Lru2Replacer() override {}
+    Algo get_algo() const override {
+        return Algo::LRU_2;
+    }
+    void access_frame(BCB *bcb, bool write) override {
+        time++;
+        remove_bcb(bcb);
+        times[bcb->frame_id][1] = times[bcb->frame_id][0];
+        times[bcb->frame_id][0] = time;
+        insert_sorted(bcb);
+    }
+    void remove_bcb(BCB *bcb) override {
+        if (times[bcb->frame_id][1] == 0) {
+            lru.remove(bcb);
+        } else if (times[bcb->frame_id][1] < 0) {
+            prefetched.remove(bcb);
+            num_prefetched--;
+        } else {
+            sorted.remove(bcb);
+        }
+    }
+    void insert_bcb(BCB *bcb, bool write) override {
+        time++;
+        times[bcb->frame_id][1] = 0;
+        times[bcb->frame_id][0] = time;
+        lru.insert_tail(bcb);
+    }
+    void park_bcb(BCB *bcb) override {
+        remove_bcb(bcb);
+    }
+    // 按记录的时间放回原来的链表
+    void unpark_bcb(BCB *bcb) override {
+        if (times[bcb->frame_id][1] == 0) {
+            lru.insert_tail(bcb);
+        } else if (times[bcb->frame_id][1] < 0) {
+            prefetched.insert_tail(bcb);
+            num_prefetched++;
+        } else {
+            insert_sorted(bcb);
+        }
+    }
+    // 预取的 page 进入单独的 FIFO 链表, 若与访问过 1 次的放在一起, 它们会在被访问前就被之后的换入换出;
+    // 该链表超过 max_prefetched 个时最先淘汰, 否则在不少于 2 次的全部淘汰后才淘汰
+    void insert_prefetched(BCB *bcb) override {
+        times[bcb->frame_id][1] = -1;
+        times[bcb->frame_id][0] = time;
+        prefetched.insert_tail(bcb);
+        num_prefetched++;
+    }
+    BCB *select_victim() override {
+        if (num_prefetched > max_prefetched) {
+            return prefetched.head;
+        } else if (lru.head) { // 首先淘汰少于 k 次的
+            return lru.head;
+        } else if (sorted.head) {
+            return sorted.head;
+        } else {
+            return prefetched.head;
+        }
+    }
+    void scan_cold(std::vector<BCB *> &out, int max) const override {
+        lru.collect(out, max);
+        prefetched.collect(out, max);
+        sorted.collect(out, max);
+    }
+private:
+    // insert bcb into sorted queue
+    void insert_sorted(BCB *bcb) {
+        int key = times[bcb->frame_id][1];
+        if (sorted.head == nullptr || times[sorted.head->frame_id][1] > key) {
+            sorted.insert_head(bcb);
+        } else {
+            BCB *p = sorted.head;
+            while (p->next() && times[p->next()->frame_id][1] <= key) {
+                STATS_INC(SCAN);
+                p = p->next();
+            }
+            BCB *next = p->next();
+            if (next) {
+                next->set_prev(bcb);
+            } else {
+                sorted.tail = bcb;
+            }
+            bcb->set_next(next);
+            bcb->set_prev(p);
+            p->set_next(bcb);
+        }
+    }
+
+    LinkedList lru; // 左侧访问次数小于 2 的 LRU 链表
+    LinkedList prefetched; // 预取后尚未被访问的, time[1] 为 -1
+    int num_prefetched;
+    int max_prefetched;
+    // 插入为线性查找, 每次命中 O(n); 基于小顶堆的实现见 LruKReplacer
+    LinkedList sorted; // 右侧访问次数不少于 2 的按照倒数第 2 时间的 FIFO 链表, 队头为最旧的, 优先出队
+    int time; // time 初始为 0, 在 times 中最小为 1, 如果出现了一个 0, 说明只访问过 1 次
+    // frame_id 作为 index, 0 为倒数第 1 次访问的时间, 1 为倒数第 2 次访问的时间 (用访问次数当作时间)
+    std::vector<std::array<int, 2>> times;
+};
+/*
+lru-2:
+    io count: 419835
+    access count: 500000
+    hit count: 217857
+    hit rate: 0.435714
+    time: 45.1056s
+*/
+
+/**
+ * 完整的 2Q (Johnson & Shasha, 1994)
+ * 1. 第一次换入的 page 进入 FIFO 的 A1in, 在 A1in 中再次被访问不移动 (视为相关访问)
+ * 2. A1in 超过 Kin 个时从 A1in 换出, 其 page_id 进入 FIFO 的 ghost 队列 A1out, A1out 至多 Kout 个
+ * 3. 换入的 page 在 A1out 中时直接进入 LRU 的 Am; 否则从 Am 换出, 不进入 A1out
+ * Kin 与 Kout 为缓冲区大小乘以 ReplacerParams 中的比例
+*/
+class TwoQueueReplacer final: public Replacer {
+public:
+    TwoQueueReplacer(int num_frames, int capacity, const ReplacerParams &params):
+        a1in(), prefetched(), num_prefetched(0), max_prefetched(capacity / PREFETCHSHARE), am(), a1out(),
+        a1in_size(0), kin((int)(params.kin * capacity)), kout((int)(params.kout * capacity)), access_times(num_frames) {}
+    ~TwoQueueReplacer() override {}
+    Algo get_algo() const override {
+        return Algo::TWO_QUEUE;
+    }
+    void access_frame(BCB *bcb, bool write) override {
+        if (access_times[bcb->frame_id] == 2) {
+            am.remove(bcb);
+            am.insert_tail(bcb);
+        } else if (access_times[bcb->frame_id] == 0) { // 预取的 page 被第一次访问时由 BufferManager 重新插入, 不会在此被访问
+            prefetched.remove(bcb);
+            num_prefetched--;
+            access_times[bcb->frame_id] = 1;
+            a1in.insert_tail(bcb);
+            a1in_size++;
+        }
+    }
+    // 从 A1in 换出的进入 A1out
+    void remove_bcb(BCB *bcb) override {
+        if (access_times[bcb->frame_id] == 1 && kout > 0) {
+            a1out.push_mru(bcb->page_id);
+            if (a1out.size() > kout) {
+                a1out.pop_lru();
+            }
+        }
+        discard_bcb(bcb);
+    }
+    // 从所在的链表中移出, 不进入 A1out
+    void discard_bcb(BCB *bcb) override {
+        if (access_times[bcb->frame_id] == 1) {
+            a1in.remove(bcb);
+            a1in_size--;
+        } else if (access_times[bcb->frame_id] == 0) {
+            prefetched.remove(bcb);
+            num_prefetched--;
+        } else {
+            am.remove(bcb);
+        }
+    }
+    void forget_page(int page_id) override {
+        if (a1out.contains(page_id)) {
+            a1out.remove(page_id);
+        }
+    }
+    void insert_bcb(BCB *bcb, bool write) override {
+        if (a1out.contains(bcb->page_id)) {
+            a1out.remove(bcb->page_id);
+            access_times[bcb->frame_id] = 2;
+            am.insert_tail(bcb);
+        } else {
+            access_times[bcb->frame_id] = 1;
+            a1in.insert_tail(bcb);
+            a1in_size++;
+        }
+    }
+    void park_bcb(BCB *bcb) override {
+        discard_bcb(bcb);
+    }
+    // 放回原来所在链表的尾部
+    void unpark_bcb(BCB *bcb) override {
+        if (access_times[bcb->frame_id] == 1) {
+            a1in.insert_tail(bcb);
+            a1in_size++;
+        } else if (access_times[bcb->frame_id] == 0) {
+            prefetched.insert_tail(bcb);
+            num_prefetched++;
+        } else {
+            am.insert_tail(bcb);
+        }
+    }
+    // 预取的 page 进入单独的 fifo, 超过 max_prefetched 个时最先淘汰, 否则最后淘汰;
+    // 第一次被访问时如同刚换入, 进入 A1in 或 Am
+    void insert_prefetched(BCB *bcb) override {
+        access_times[bcb->frame_id] = 0;
+        prefetched.insert_tail(bcb);
+        num_prefetched++;
+    }
+    BCB *select_victim() override {
+        if (num_prefetched > max_prefetched) {
+            return prefetched.head;
+        } else if (a1in.head && (a1in_size > kin || !am.head)) {
+            return a1in.head;
+        } else if (am.head) {
+            return am.head;
+        } else {
+            return prefetched.head;
+        }
+    }
+    void scan_cold(std::vector<BCB *> &out, int max) const override {
+        if (a1in_size > kin) {
+            a1in.collect(out, max);
+        }
+        am.collect(out, max);
+        if (a1in_size <= kin) {
+            a1in.collect(out, max);
+        }
+        prefetched.collect(out, max);
+    }
+private:
+    LinkedList a1in; // 只访问过 1 次的 fifo, access_times 为 1
+    LinkedList prefetched; // 预取后尚未被访问的 fifo, access_times 为 0
+    int num_prefetched;
+    int max_prefetched;
+    LinkedList am; // 换出后很快又被访问的 lru, access_times 为 2
+    GhostList a1out; // 从 A1in 换出的 page_id
+    int a1in_size;
+    int kin;
+    int kout;
+    std::vector<char> access_times; // frame_id 作为 index, 访问过 0 次 (预取), 1 次, 2 次
+};
+
+/**
+ * LRU-K (O'Neil 等, 1993), 用以 frame_id 为下标的小顶堆实现, 访问与换出均为 O(log n)
+ * 1. 每个 frame 记录最近 K 次不相关访问的时间 hist[0..K-1] (hist[0] 为最近一次, 0 表示没有) 与最后一次访问时间 last
+ * 2. 距上一次访问不超过 correlated_period 的访问视为相关访问, 只更新 last; 否则历史整体后移, 并加上相关周期的长度
+ * 3. 访问次数少于 K 的 page 先被换出, 其间按最近一次访问 LRU; 其余按倒数第 K 次访问时间最早的先换出;
+ *    仍在相关周期内的 page 不被选中, 除非所有 page 都在相关周期内
+ * 4. retained_history 不为 0 时, 保留最近换出的至多这么多个 page 的历史, 以 page_id 为键, 再次换入时恢复;
+ *    被删除的 page 不保留历史
+ * K 为 2 且两者都为 0 时与 Lru2Replacer 的选择完全相同
+*/
+class LruKReplacer final: public Replacer {
+public:
+    LruKReplacer(int num_frames, int capacity, const ReplacerParams &params):
+        k(std::max(1, params.k)), correlated_period(params.correlated_period), retained_history(params.retained_history),
+        time(0), hist((size_t)num_frames * k, 0), last(num_frames, 0), pos(num_frames, -1), bcbs(num_frames, nullptr),
+        in_prefetched(num_frames, 0), prefetched(), num_prefetched(0), max_prefetched(capacity / PREFETCHSHARE), history_seq(0) {}
+    ~LruKReplacer() override {}
+    Algo get_algo() const override {
+        return Algo::LRU_K;
+    }
+    void access_frame(BCB *bcb, bool write) override {
+        int frame_id = bcb->frame_id;
+        if (in_prefetched[frame_id]) { // 预取的 page 被第一次访问时由 BufferManager 重新插入, 一般不会在此被访问
+            prefetched.remove(bcb);
+            num_prefetched--;
+            in_prefetched[frame_id] = 0;
+            push(frame_id);
+        }
+        time++;
+        reference(frame_id);
+        sift_up(pos[frame_id]);
+        sift_down(pos[frame_id]);
+    }
+    // 换出时保留历史, 预取后未被访问的没有历史
+    void remove_bcb(BCB *bcb) override {
+        bool accessed = !in_prefetched[bcb->frame_id];
+        discard_bcb(bcb);
+        if (accessed) {
+            retain(bcb->page_id, bcb->frame_id);
+        }
+    }
+    void discard_bcb(BCB *bcb) override {
+        int frame_id = bcb->frame_id;
+        if (in_prefetched[frame_id]) {
+            prefetched.remove(bcb);
+            num_prefetched--;
+            in_prefetched[frame_id] = 0;
+            return;
+        }
+        erase(frame_id);
+    }
+    // history_order 中留下的记录按 seq 判断已过期
+    void forget_page(int page_id) override {
+        history.erase(page_id);
+    }
+    void park_bcb(BCB *bcb) override {
+        if (in_prefetched[bcb->frame_id]) {
+            prefetched.remove(bcb);
+            num_prefetched--;
+        } else {
+            erase(bcb->frame_id);
+        }
+    }
+    // 历史没有改变, 按原来的 key 放回堆中
+    void unpark_bcb(BCB *bcb) override {
+        if (in_prefetched[bcb->frame_id]) {
+            prefetched.insert_tail(bcb);
+            num_prefetched++;
+        } else {
+            push(bcb->frame_id);
+        }
+    }
+    void insert_bcb(BCB *bcb, bool write) override {
+        int frame_id = bcb->frame_id;
+        bcbs[frame_id] = bcb;
+        time++;
+        std::fill(&hist[(size_t)frame_id * k], &hist[(size_t)frame_id * k] + k, 0);
+        last[frame_id] = 0;
+        auto it = history.find(bcb->page_id);
+        if (it != history.end()) { // 恢复换出前的历史, 本次换入作为又一次访问
+            std::copy(it->second.hist.begin(), it->second.hist.end(), &hist[(size_t)frame_id * k]);
+            last[frame_id] = it->second.last;
+            history.erase(it);
+        }
+        reference(frame_id);
+        push(frame_id);
+    }
+    // 与 Lru2Replacer 相同, 预取的 page 进入单独的 FIFO 链表, 不进入堆
+    void insert_prefetched(BCB *bcb) override {
+        bcbs[bcb->frame_id] = bcb;
+        prefetched.insert_tail(bcb);
+        num_prefetched++;
+        in_prefetched[bcb->frame_id] = 1;
+    }
+    BCB *select_victim() override {
+        if (num_prefetched > max_prefetched || heap.empty()) {
+            return prefetched.head;
+        }
+        if (correlated_period == 0) {
+            return bcbs[heap[0]];
+        }
+        // 按 key 从小到大遍历堆, 找到第一个不在相关周期内的; 相关周期内的 page 至多 correlated_period 个
+        auto greater = [this](int a, int b) { return less(heap[b], heap[a]); };
+        std::vector<int> candidates {0};
+        while (!candidates.empty()) {
+            std::pop_heap(candidates.begin(), candidates.end(), greater);
+            int i = candidates.back();
+            candidates.pop_back();
+            if (time - last[heap[i]] > correlated_period) {
+                return bcbs[heap[i]];
+            }
+            for (int child = 2 * i + 1; child <= 2 * i + 2 && child < (int)heap.size(); child++) {
+                candidates.push_back(child);
+                std::push_heap(candidates.begin(), candidates.end(), greater);
+            }
+        }
+        return bcbs[heap[0]];
+    }
+    void scan_cold(std::vector<BCB *> &out, int max) const override {
+        if (num_prefetched > max_prefetched) {
+            prefetched.collect(out, max);
+        }
+        // 堆不是有序的, 取出 key 最小的 max 个
+        std::vector<int> frames(heap);
+        int n = std::min((int)frames.size(), std::max(0, max - (int)out.size()));
+        std::partial_sort(frames.begin(), frames.begin() + n, frames.end(), [this](int a, int b) { return less(a, b); });
+        for (int i = 0; i < n; i++) {
+            out.push_back(bcbs[frames[i]]);
+        }
+        if (num_prefetched <= max_prefetched) {
+            prefetched.collect(out, max);
+        }
+    }
+private:
+    struct History {
+        std::vector<int> hist;
+        int last;
+        long long seq;
+    };
+    // 一次访问: 不相关的访问使历史后移
+    void reference(int frame_id) {
+        int *h = &hist[(size_t)frame_id * k];
+        if (last[frame_id] == 0 || time - last[frame_id] > correlated_period) {
+            int correlated = last[frame_id] - h[0]; // 上一个相关周期的长度, 之前的历史一并后移
+            for (int i = k - 1; i > 0; i--) {
+                h[i] = h[i - 1] != 0 ? h[i - 1] + correlated : 0;
+            }
+            h[0] = time;
+        }
+        last[frame_id] = time;
+    }
+    // 少于 K 次的 key 为 (0, hist[0]), 否则为 (1, hist[K-1])
+    bool less(int a, int b) const {
+        int ka = hist[(size_t)a * k + k - 1], kb = hist[(size_t)b * k + k - 1];
+        if ((ka == 0) != (kb == 0)) {
+            return ka == 0;
+        }
+        if (ka == 0) {
+            return hist[(size_t)a * k] < hist[(size_t)b * k];
+        }
+        return ka < kb;
+    }
+    void erase(int frame_id) {
+        int i = pos[frame_id];
+        int moved = heap.back();
+        heap[i] = moved;
+        pos[moved] = i;
+        heap.pop_back();
+        pos[frame_id] = -1;
+        if (moved != frame_id) {
+            sift_up(i);
+            sift_down(pos[moved]);
+        }
+    }
+    void push(int frame_id) {
+        pos[frame_id] = (int)heap.size();
+        heap.push_back(frame_id);
+        sift_up(pos[frame_id]);
+    }
+    void sift_up(int i) {
+        int frame_id = heap[i];
+        while (i > 0 && less(frame_id, heap[(i - 1) / 2])) {
+            heap[i] = heap[(i - 1) / 2];
+            pos[heap[i]] = i;
+            i = (i - 1) / 2;
+        }
+        heap[i] = frame_id;
+        pos[frame_id] = i;
+    }
+    void sift_down(int i) {
+        int n = (int)heap.size(), frame_id = heap[i];
+        while (2 * i + 1 < n) {
+            int child = 2 * i + 1;
+            if (child + 1 < n && less(heap[child + 1], heap[child])) {
+                child++;
+            }
+            if (!less(heap[child], frame_id)) {
+                break;
+            }
+            heap[i] = heap[child];
+            pos[heap[i]] = i;
+            i = child;
+        }
+        heap[i] = frame_id;
+        pos[frame_id] = i;
+    }
+    // 保留被换出 page 的历史, 超过 retained_history 个时丢弃最早的
+    void retain(int page_id, int frame_id) {
+        if (retained_history == 0 || page_id < 0) {
+            return;
+        }
+        const int *h = &hist[(size_t)frame_id * k];
+        history[page_id] = {std::vector<int>(h, h + k), last[frame_id], ++history_seq};
+        history_order.push_back({page_id, history_seq});
+        while ((int)history.size() > retained_history) {
+            auto oldest = history_order.front();
+            history_order.pop_front();
+            auto it = history.find(oldest.first);
+            if (it != history.end() && it->second.seq == oldest.second) {
+                history.erase(it);
+            }
+        }
+        // 再次换入的 page 在 history_order 中留下过期的记录, 过多时整理
+        if (history_order.size() > 2 * (size_t)retained_history + 64) {
+            std::deque<std::pair<int, long long>> live;
+            for (auto &entry : history_order) {
+                auto it = history.find(entry.first);
+                if (it != history.end() && it->second.seq == entry.second) {
+                    live.push_back(entry);
+                }
+            }
+            history_order.swap(live);
+        }
+    }
+
+    int k;
+    int correlated_period;
+    int retained_history;
+    int time; // 每次访问加一, 0 表示没有访问
+    std::vector<int> hist; // frame_id * k + i 为 frame 倒数第 i + 1 次不相关访问的时间
+    std::vector<int> last; // frame 最后一次访问的时间
+    std::vector<int> heap; // 按 key 的小顶堆, 元素为 frame_id
+    std::vector<int> pos; // frame 在堆中的下标, -1 为不在堆中
+    std::vector<BCB *> bcbs;
+    std::vector<char> in_prefetched; // frame_id 作为 index, 是否在预取链表中
+    LinkedList prefetched;
+    int num_prefetched;
+    int max_prefetched;
+    std::unordered_map<int, History> history; // 换出后保留的历史, page_id 为键
+    std::deque<std::pair<int, long long>> history_order; // (page_id, seq), 按换出先后
+    long long history_seq;
+};
+
+/**
+ * ARC 与 CAR 共同的部分: 缓存中的 page 分为只访问过 1 次的 T1 与访问过多次的 T2,
+ * 被换出的 page 进入对应的 ghost 链表 B1/B2. 换入的 page 命中 B1 时增大 T1 的目标大小 p, 命中 B2 时减小 p.
+ * c 为缓冲区大小, 保持 |T1| + |B1| <= c 且 |T1| + |T2| + |B1| + |B2| <= 2c.
+ *
+ * 原算法换出时需要知道换入的 page 是否在 B2 中, 而 select_victim 在换入前调用且不知道换入的 page,
+ * 因此换出只按 |T1| 与 p 比较决定, 相等时淘汰 T2.
+ * 预取的 page 放入 T1, 若在被访问前换出则不进入 B1, 也不调整 p.
+ *
+ * T1 与 T2 的实际结构由子类 Derived 通过 insert_recent/insert_frequent/remove_recent/remove_frequent 维护,
+ * 这些函数经 CRTP 静态分派, 不是虚函数, 以 ArcReplacer/CarReplacer 实例化的 BasicBufferManager 中可以内联
+*/
+template <typename Derived>
+class AdaptiveReplacer: public Replacer {
+public:
+    AdaptiveReplacer(int num_frames, int capacity): c(capacity), p(0), where(num_frames, NONE), prefetched(num_frames, 0) {}
+    void insert_bcb(BCB *bcb, bool write) override {
+        int page_id = bcb->page_id;
+        if (b1.contains(page_id)) {
+            p = std::min(c, p + std::max(1, b2.size() / b1.size()));
+            b1.remove(page_id);
+            self().insert_frequent(bcb);
+        } else if (b2.contains(page_id)) {
+            p = std::max(0, p - std::max(1, b1.size() / b2.size()));
+            b2.remove(page_id);
+            self().insert_frequent(bcb);
+        } else {
+            if (t1_size + b1.size() >= c && b1.size() > 0) {
+                b1.pop_lru();
+            } else if (t1_size + t2_size + b1.size() + b2.size() >= 2 * c && b2.size() > 0) {
+                b2.pop_lru();
+            }
+            self().insert_recent(bcb);
+        }
+        prefetched[bcb->frame_id] = 0;
+    }
+    void insert_prefetched(BCB *bcb) override {
+        self().insert_recent(bcb);
+        prefetched[bcb->frame_id] = 1;
+    }
+    void remove_bcb(BCB *bcb) override {
+        int frame_id = bcb->frame_id;
+        if (where[frame_id] == T1 && !prefetched[frame_id]) {
+            b1.push_mru(bcb->page_id);
+        } else if (where[frame_id] == T2) {
+            b2.push_mru(bcb->page_id);
+        }
+        discard_bcb(bcb);
+    }
+    // 不进入 ghost 链表, 也不调整 p
+    void discard_bcb(BCB *bcb) override {
+        int frame_id = bcb->frame_id;
+        if (where[frame_id] == T1) {
+            self().remove_recent(bcb);
+        } else if (where[frame_id] == T2) {
+            self().remove_frequent(bcb);
+        }
+        where[frame_id] = NONE;
+        prefetched[frame_id] = 0;
+    }
+    void forget_page(int page_id) override {
+        if (b1.contains(page_id)) {
+            b1.remove(page_id);
+        } else if (b2.contains(page_id)) {
+            b2.remove(page_id);
+        }
+    }
+    // 从 T1 或 T2 中移出, 不进入 ghost 链表, 也不改变 where
+    void park_bcb(BCB *bcb) override {
+        if (where[bcb->frame_id] == T1) {
+            self().remove_recent(bcb);
+        } else {
+            self().remove_frequent(bcb);
+        }
+    }
+    void unpark_bcb(BCB *bcb) override {
+        if (where[bcb->frame_id] == T1) {
+            self().insert_recent(bcb);
+        } else {
+            self().insert_frequent(bcb);
+        }
+    }
+protected:
+    enum List : char {NONE, T1, T2};
+    Derived &self() { return static_cast<Derived &>(*this); }
+
+    int c;
+    int p; // T1 的目标大小
+    int t1_size = 0;
+    int t2_size = 0;
+    GhostList b1, b2;
+    std::vector<char> where; // frame_id 作为 index, 所在的链表
+    std::vector<char> prefetched;
+};
+
+// ARC (Megiddo & Modha, 2003), T1 与 T2 都是 LRU 链表, 命中时移到 T2 的 MRU 端
+class ArcReplacer final: public AdaptiveReplacer<ArcReplacer> {
+public:
+    ArcReplacer(int num_frames, int capacity): AdaptiveReplacer(num_frames, capacity) {}
+    ~ArcReplacer() override {}
+    Algo get_algo() const override {
+        return Algo::ARC;
+    }
+    void access_frame(BCB *bcb, bool write) override {
+        if (where[bcb->frame_id] == T1) {
+            remove_recent(bcb);
+        } else {
+            remove_frequent(bcb);
+        }
+        prefetched[bcb->frame_id] = 0;
+        insert_frequent(bcb);
+    }
+    BCB *select_victim() override {
+        if (t1.head && (t1_size > p || !t2.head)) {
+            return t1.head;
+        }
+        return t2.head;
+    }
+    void scan_cold(std::vector<BCB *> &out, int max) const override {
+        if (t1_size > p) {
+            t1.collect(out, max);
+            t2.collect(out, max);
+        } else {
+            t2.collect(out, max);
+            t1.collect(out, max);
+        }
+    }
+private:
+    friend class AdaptiveReplacer<ArcReplacer>;
+    void insert_recent(BCB *bcb) {
+        t1.insert_tail(bcb);
+        where[bcb->frame_id] = T1;
+        t1_size++;
+    }
+    void insert_frequent(BCB *bcb) {
+        t2.insert_tail(bcb);
+        where[bcb->frame_id] = T2;
+        t2_size++;
+    }
+    void remove_recent(BCB *bcb) {
+        t1.remove(bcb);
+        t1_size--;
+    }
+    void remove_frequent(BCB *bcb) {
+        t2.remove(bcb);
+        t2_size--;
+    }
+
+    LinkedList t1, t2; // 头为 LRU
+};
+
+/**
+ * CAR (Bansal & Modha, 2004), T1 与 T2 是两个 CLOCK, 命中时只设置访问位, 不移动 BCB;
+ * 选择换出时 T1 头部被访问过的 BCB 清除访问位后移到 T2 尾部, T2 头部被访问过的清除访问位后移到 T2 尾部
+*/
+class CarReplacer final: public AdaptiveReplacer<CarReplacer> {
+public:
+    CarReplacer(int num_frames, int capacity): AdaptiveReplacer(num_frames, capacity), referenced(num_frames, 0) {}
+    ~CarReplacer() override {}
+    Algo get_algo() const override {
+        return Algo::CAR;
+    }
+    void access_frame(BCB *bcb, bool write) override {
+        referenced[bcb->frame_id] = 1;
+        prefetched[bcb->frame_id] = 0;
+    }
+    BCB *select_victim() override {
+        // 每个 BCB 至多被移动一次后访问位即为 0, 故循环有界
+        for (int steps = 0; steps <= 2 * (t1_size + t2_size); steps++) {
+            STATS_INC(SCAN);
+            if (t1.head && (t1_size >= std::max(1, p) || !t2.head)) {
+                BCB *head = t1.head;
+                if (!referenced[head->frame_id]) {
+                    return head;
+                }
+                referenced[head->frame_id] = 0;
+                t1.remove(head);
+                t2.insert_tail(head);
+                where[head->frame_id] = T2;
+                t1_size--;
+                t2_size++;
+            } else if (t2.head) {
+                BCB *head = t2.head;
+                if (!referenced[head->frame_id]) {
+                    return head;
+                }
+                referenced[head->frame_id] = 0;
+                t2.remove(head);
+                t2.insert_tail(head);
+            } else {
+                return nullptr;
+            }
+        }
+        return nullptr;
+    }
+    // 按指针将要经过的顺序, 访问位为 0 的在前
+    void scan_cold(std::vector<BCB *> &out, int max) const override {
+        const LinkedList &first = t1_size >= std::max(1, p) ? t1 : t2;
+        const LinkedList &second = &first == &t1 ? t2 : t1;
+        for (int bit = 0; bit <= 1; bit++) {
+            for (const LinkedList *list : {&first, &second}) {
+                for (BCB *q = list->head; q != nullptr && (int)out.size() < max; q = q->next()) {
+                    if (referenced[q->frame_id] == bit) {
+                        out.push_back(q);
+                    }
+                }
+            }
+        }
+    }
+private:
+    friend class AdaptiveReplacer<CarReplacer>;
+    void insert_recent(BCB *bcb) {
+        t1.insert_tail(bcb);
+        where[bcb->frame_id] = T1;
+        referenced[bcb->frame_id] = 0;
+        t1_size++;
+    }
+    void insert_frequent(BCB *bcb) {
+        t2.insert_tail(bcb);
+        where[bcb->frame_id] = T2;
+        referenced[bcb->frame_id] = 0;
+        t2_size++;
+    }
+    void remove_recent(BCB *bcb) {
+        t1.remove(bcb);
+        t1_size--;
+    }
+    void remove_frequent(BCB *bcb) {
+        t2.remove(bcb);
+        t2_size--;
+    }
+
+    LinkedList t1, t2; // 头为时钟指针所指的位置
+    std::vector<char> referenced;
+};
+
+// 各个算法的 BasicBufferManager 在 static_buffer.cpp 中显式实例化
+extern template class BasicBufferManager<LruReplacer>;
+extern template class BasicBufferManager<MruReplacer>;
+extern template class BasicBufferManager<RandomReplacer>;
+extern template class BasicBufferManager<ClockReplacer>;
+extern template class BasicBufferManager<ClockProReplacer>;
+extern template class BasicBufferManager<Lru2Replacer>;
+extern template class BasicBufferManager<TwoQueueReplacer>;
+extern template class BasicBufferManager<LruKReplacer>;
+extern template class BasicBufferManager<ArcReplacer>;
+extern template class BasicBufferManager<CarReplacer>;
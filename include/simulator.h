@@ -0,0 +1,41 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "buffer.h"
+#include "trace.h"
+
+#define SIMPAGESIZE 64 // 模拟时的 page 大小, frame 的内容从不被访问, 只需要足够容纳 header 的位图
+
+/**
+ * 替换算法的模拟器
+ *
+ * 以 NONE 方式的 DataStorageManager 回放 trace, 不做真实 I/O, 但仍经过 BufferManager 的完整流程
+ * (哈希表, replacer, dirty 标记与换出时的写回). 每个 (算法, 缓冲区大小) 组合使用各自的 DataStorageManager
+ * 与 BufferManager, 由一个线程独立回放, 至多 jobs 个线程同时运行. 结果按加入的顺序输出为 CSV, 每行一个组合.
+*/
+class Simulator {
+public:
+    explicit Simulator(const Trace &trace, const ReplacerParams &params = ReplacerParams());
+    void add(const std::string &algo_name, Replacer::Algo algo, int num_frames);
+    void run(int jobs);
+    void write_csv(std::ostream &out) const;
+private:
+    struct Config {
+        std::string algo_name;
+        Replacer::Algo algo;
+        int num_frames;
+        // 结果
+        int hits;
+        int reads;
+        int writes; // 换出时写回的 page 数, 不包括结束时的写回
+        double seconds;
+    };
+    void simulate(Config &config) const;
+
+    const Trace &m_trace;
+    ReplacerParams m_params;
+    int m_num_pages; // trace 中最大的 page_id 加 1
+    std::vector<Config> m_configs;
+};
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+#define STATSBUCKETS 40 // 延迟直方图的桶数, 第 i 个桶为 [2^(i-1), 2^i) 纳秒, 第 0 个桶为 0 纳秒
+
+/**
+ * 缓冲区管理器的统计
+ *
+ * 以 ADBSTATS 编译时启用, 否则所有 STATS_* 宏展开为空, 不产生任何代码.
+ * 每个线程第一次记录时分配自己的计数器与直方图, 之后只由该线程修改 (relaxed 的原子读写, 没有共享的 cache line),
+ * snapshot 将所有线程的数据相加得到快照. 统计是进程全局的, 同时存在多个 BufferManager 时它们的数据合在一起.
+ * 线程退出后其数据仍然保留, 计入之后的快照.
+ * 计数器总是记录; 读时钟的开销远大于计数, 因而延迟直方图只在 set_timing(true) 之后记录.
+*/
+class Stats {
+public:
+    enum Counter {
+        FIX, // fix_page 次数
+        HIT,
+        MISS,
+        EVICT, // 换出的 page 数
+        DIRTY_EVICT, // 换出时需要写回的 page 数
+        LOOKUP, // 哈希表查找次数
+        PROBE, // 哈希表查找经过的槽位数, 与 LOOKUP 之比为平均探测长度
+        VICTIM, // replacer 选择换出 page 的次数
+        SCAN, // replacer 选择时扫描 (时钟指针移动或链表遍历) 的步数
+        READ_CALL, // DataStorageManager 的读调用次数
+        READ_PAGE, // 读入的 page 数
+        WRITE_CALL,
+        WRITE_PAGE,
+        NUM_COUNTERS
+    };
+    enum Histogram {
+        FIX_LATENCY, // fix_page 的耗时
+        MISS_LATENCY, // 未命中的 fix_page 的耗时
+        READ_LATENCY, // 一次读调用的耗时
+        WRITE_LATENCY,
+        NUM_HISTOGRAMS
+    };
+    // 一个线程的统计
+    struct alignas(64) ThreadStats {
+        std::atomic<long long> counters[NUM_COUNTERS];
+        std::atomic<long long> histograms[NUM_HISTOGRAMS][STATSBUCKETS];
+        ThreadStats *next; // 所有线程的统计构成的链表
+    };
+    struct Snapshot {
+        long long counters[NUM_COUNTERS];
+        long long histograms[NUM_HISTOGRAMS][STATSBUCKETS];
+        double seconds; // 第一次记录到快照时的时间
+        long long count(Histogram histogram) const;
+        long long percentile(Histogram histogram, double p) const; // 返回所在桶的上界 (纳秒)
+        void write_json(std::ostream &out) const; // 一行一个对象
+        static void write_csv_header(std::ostream &out);
+        void write_csv(std::ostream &out) const;
+    };
+    static constexpr bool enabled() {
+#ifdef ADBSTATS
+        return true;
+#else
+        return false;
+#endif
+    }
+    static Snapshot snapshot();
+    static void set_timing(bool timing) { s_timing.store(timing, std::memory_order_relaxed); }
+    static bool timing() { return s_timing.load(std::memory_order_relaxed); }
+    static void add(Counter counter, long long n) {
+        std::atomic<long long> &value = local().counters[counter];
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    static void record(Histogram histogram, long long ns) {
+        std::atomic<long long> &value = local().histograms[histogram][bucket(ns)];
+        value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    static int bucket(long long ns) {
+        int b = ns <= 0 ? 0 : 64 - __builtin_clzll((unsigned long long)ns);
+        return b < STATSBUCKETS ? b : STATSBUCKETS - 1;
+    }
+    static long long now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+private:
+    static ThreadStats &local() {
+        static thread_local ThreadStats *stats = nullptr;
+        if (stats == nullptr) {
+            stats = enroll();
+        }
+        return *stats;
+    }
+    static ThreadStats *enroll();
+    static std::atomic<bool> s_timing;
+};
+
+// 计时的作用域, 离开时记录从构造开始的耗时
+class StatsScope {
+public:
+    explicit StatsScope(Stats::Histogram histogram): m_histogram(histogram), m_start(Stats::timing() ? Stats::now() : -1) {}
+    ~StatsScope() { record(m_histogram); }
+    // 以构造时的时间记录到 histogram, 构造时没有开启计时则不记录
+    void record(Stats::Histogram histogram) const {
+        if (m_start >= 0) {
+            Stats::record(histogram, Stats::now() - m_start);
+        }
+    }
+private:
+    Stats::Histogram m_histogram;
+    long long m_start;
+};
+
+/**
+ * 周期性地将快照写入 out 的后台线程, csv 为 false 时每行一个 JSON 对象.
+ * 构造时写一次 (CSV 时先写表头), 之后每 interval_ms 毫秒写一次, 析构时停止并写最后一次
+*/
+class StatsDumper {
+public:
+    StatsDumper(std::ostream &out, bool csv, int interval_ms);
+    ~StatsDumper();
+    StatsDumper(const StatsDumper &) = delete;
+    StatsDumper &operator=(const StatsDumper &) = delete;
+private:
+    void dump();
+    void work();
+
+    std::ostream &m_out;
+    bool m_csv;
+    int m_interval_ms;
+    std::mutex m_latch;
+    std::condition_variable m_cond;
+    bool m_stop;
+    std::thread m_thread;
+};
+
+#ifdef ADBSTATS
+#define STATS_ADD(counter, n) Stats::add(Stats::counter, (n))
+#define STATS_INC(counter) Stats::add(Stats::counter, 1)
+#define STATS_SCOPE(histogram) StatsScope stats_scope_ {Stats::histogram}
+// 以 STATS_SCOPE 的开始时间记录另一个直方图, 用于只在某些路径上记录的耗时
+#define STATS_RECORD_SCOPE(histogram) stats_scope_.record(Stats::histogram)
+// 记录在别处测得的耗时, 同样只在开启计时后记录
+#define STATS_RECORD(histogram, ns) (Stats::timing() ? Stats::record(Stats::histogram, (ns)) : (void)0)
+#else
+#define STATS_ADD(counter, n) ((void)0)
+#define STATS_INC(counter) ((void)0)
+#define STATS_SCOPE(histogram) ((void)0)
+#define STATS_RECORD_SCOPE(histogram) ((void)0)
+#define STATS_RECORD(histogram, ns) ((void)0)
+#endif
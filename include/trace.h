@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define TRACEMAGIC "ADBTRC01" // 二进制 trace 文件头的魔数, 8 字节
+
+/**
+ * 访问序列 (trace), 以 struct-of-arrays 形式保存: page_id 与读写标志各为一个连续数组
+ *
+ * 支持两种文件格式, load 时按文件头自动识别:
+ * 1. 文本: 每行 "write,page_id", 整个文件 mmap 后由手写的整数解析器一次扫描完成, 解析后即 munmap
+ * 2. 二进制: 16 字节文件头 (TRACEMAGIC 与 uint64 的访问数 n), 之后为 n 个 int32 的 page_id 与 n 个 uint8 的读写标志.
+ *    文件以 MAP_POPULATE 方式 mmap, 直接在映射上访问, 不需要任何解析, 也不会在回放时发生缺页
+ * 文本格式可以由 save_binary 转换为二进制格式. 也可以由 assign 直接使用内存中生成的访问序列 (见 workload.h).
+*/
+class Trace {
+public:
+    Trace();
+    ~Trace();
+    Trace(const Trace &) = delete;
+    Trace &operator=(const Trace &) = delete;
+    int load(const std::string &filename); // 失败返回 -1
+    int save_binary(const std::string &filename) const; // 失败返回 -1
+    void assign(std::vector<int32_t> page_ids, std::vector<uint8_t> writes); // 使用内存中生成的访问序列, 两者长度相同
+    size_t size() const { return m_size; }
+    int page_id(size_t i) const { return m_page_ids[i]; }
+    int write(size_t i) const { return m_writes[i]; }
+    bool is_binary() const { return m_map != nullptr; }
+private:
+    struct Header {
+        char magic[8];
+        uint64_t count;
+    };
+    int parse_text(const char *data, size_t length);
+    int map_binary(void *map, size_t length);
+    void clear();
+
+    const int32_t *m_page_ids;
+    const uint8_t *m_writes;
+    size_t m_size;
+    // 文本格式解析得到的数组
+    std::vector<int32_t> m_page_id_buffer;
+    std::vector<uint8_t> m_write_buffer;
+    // 二进制格式的映射
+    void *m_map;
+    size_t m_map_length;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "trace.h"
+
+// 合成 workload 的参数, 只被用到它的 workload 读取
+struct WorkloadParams {
+    int num_pages = 50000; // page_id 的范围为 [0, num_pages)
+    size_t num_accesses = 500000;
+    double skew = 0.99; // zipf 的偏斜参数 s, 第 i 热的 page 的概率正比于 1 / i^s
+    double write_ratio = 0.1; // 每个访问为写的概率
+    int scan_interval = 100000; // SCAN_HOT 中每隔多少个访问插入一次全表扫描
+    int shift_interval = 50000; // SHIFTING 中每隔多少个访问移动一次热点
+    unsigned seed = 42;
+};
+
+/**
+ * 合成 workload 生成器, 在内存中生成访问序列并交给 Trace::assign
+ *
+ * 1. ZIPF: 按 zipf 分布访问, page 的热度顺序是一个固定的随机排列, 热的 page 在 page_id 上不相邻
+ * 2. UNIFORM: 均匀随机访问
+ * 3. SCAN: 循环地顺序扫描全部 page
+ * 4. SCAN_HOT: ZIPF 的热点访问, 每隔 scan_interval 个访问插入一次对全部 page 的顺序扫描
+ * 5. SHIFTING: ZIPF 的热点访问, 每隔 shift_interval 个访问热点整体平移 num_pages / 10 个 page
+ * 同样的参数总是生成同样的序列. 给出 scans 时, 其中每个访问对应一个字节, 属于顺序扫描 (SCAN 与 SCAN_HOT 的扫描部分)
+ * 的访问为 1, 供回放时以顺序扫描的访问策略访问.
+*/
+class Workload {
+public:
+    enum Kind {ZIPF, UNIFORM, SCAN, SCAN_HOT, SHIFTING, NUM_KINDS};
+    static bool parse(const std::string &name, Kind &kind);
+    static const char *name(Kind kind);
+    static void generate(Kind kind, const WorkloadParams &params, Trace &trace, std::vector<uint8_t> *scans = nullptr);
+};
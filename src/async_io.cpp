@@ -0,0 +1,365 @@
+#include "async_io.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "stats.h"
+
+#define URING_STOP UINT64_MAX // 用于唤醒并结束完成线程的 NOP 请求
+
+AsyncIo::AsyncIo(DataStorageManager *dsmgr, Engine engine, int queue_depth):
+    m_dsmgr(dsmgr), m_engine(engine), m_queue_depth(queue_depth), m_requests(queue_depth), m_ring_fd(-1),
+    m_stop(false), m_in_flight(0), m_max_depth(0), m_depth_sum(0), m_reads(0), m_writes(0)
+{
+    for (int i = queue_depth - 1; i >= 0; i--) {
+        m_free_slots.push_back(i);
+    }
+    for (int i = 0; i < AIOBUCKETS; i++) {
+        m_read_latency[i] = m_write_latency[i] = 0;
+    }
+    // io_uring 需要文件描述符, STDIO 与 NONE 方式只能使用线程池
+    if (m_engine == IO_URING && (dsmgr->get_fd() < 0 || !uring_setup())) {
+        m_engine = THREAD_POOL;
+    }
+    if (m_engine == IO_URING) {
+        m_threads.emplace_back(&AsyncIo::uring_reap, this);
+    } else {
+        for (int i = 0; i < AIOTHREADS; i++) {
+            m_threads.emplace_back(&AsyncIo::pool_work, this);
+        }
+    }
+}
+
+AsyncIo::~AsyncIo()
+{
+    drain();
+    if (m_engine == IO_URING) {
+        bool stopped;
+        {
+            std::lock_guard<std::mutex> sq_latch {m_sq_latch};
+            unsigned tail = *m_sq_tail;
+            unsigned index = tail & *m_sq_mask;
+            struct io_uring_sqe *sqe = &m_sqes[index];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_NOP;
+            sqe->user_data = URING_STOP;
+            m_sq_array[index] = index;
+            __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+            stopped = uring_enter();
+        }
+        if (!stopped) {
+            // 无法唤醒完成线程, 它仍在等待环上的事件, 只能让它与环一同留到进程结束
+            std::cerr << "error: failed to stop io_uring completion thread" << std::endl;
+            m_threads[0].detach();
+            return;
+        }
+        m_threads[0].join();
+        munmap(m_sqes, m_sqes_size);
+        if (m_cq_ptr != m_sq_ptr) {
+            munmap(m_cq_ptr, m_cq_size);
+        }
+        munmap(m_sq_ptr, m_sq_size);
+        close(m_ring_fd);
+    } else {
+        {
+            std::lock_guard<std::mutex> slot_latch {m_slot_latch};
+            m_stop = true;
+        }
+        m_pending_cond.notify_all();
+        for (auto &thread : m_threads) {
+            thread.join();
+        }
+    }
+}
+
+int AsyncIo::submit_read(int page_id, char *frame)
+{
+    return submit(page_id, frame, false, nullptr);
+}
+
+int AsyncIo::submit_write(int page_id, const char *frame)
+{
+    return submit(page_id, const_cast<char *>(frame), true, nullptr);
+}
+
+void AsyncIo::submit_read(int page_id, char *frame, Callback callback)
+{
+    submit(page_id, frame, false, std::move(callback));
+}
+
+void AsyncIo::submit_write(int page_id, const char *frame, Callback callback)
+{
+    submit(page_id, const_cast<char *>(frame), true, std::move(callback));
+}
+
+int AsyncIo::submit(int page_id, char *frame, bool write, Callback callback)
+{
+    int slot;
+    {
+        // 请求内容在锁内填写, 完成线程在锁内读取, 从而不依赖内核环形队列的内存序
+        std::unique_lock<std::mutex> slot_latch {m_slot_latch};
+        m_slot_cond.wait(slot_latch, [this]() { return !m_free_slots.empty(); });
+        slot = m_free_slots.back();
+        m_free_slots.pop_back();
+        Request &request = m_requests[slot];
+        request.page_id = page_id;
+        request.frame = frame;
+        request.write = write;
+        request.done = false;
+        request.result = 0;
+        request.callback = std::move(callback);
+        request.iov.iov_base = frame;
+        request.iov.iov_len = m_dsmgr->get_page_size();
+        request.start = std::chrono::steady_clock::now();
+    }
+    int depth = ++m_in_flight;
+    m_depth_sum += depth;
+    for (int max = m_max_depth; depth > max && !m_max_depth.compare_exchange_weak(max, depth);) {}
+    if (write) {
+        m_writes++;
+    } else {
+        m_reads++;
+    }
+    if (m_engine == IO_URING) {
+        uring_submit(slot, page_id, write);
+    } else {
+        {
+            std::lock_guard<std::mutex> slot_latch {m_slot_latch};
+            m_pending.push_back(slot);
+        }
+        m_pending_cond.notify_one();
+    }
+    return slot;
+}
+
+int AsyncIo::wait(int ticket)
+{
+    std::unique_lock<std::mutex> slot_latch {m_slot_latch};
+    m_slot_cond.wait(slot_latch, [this, ticket]() { return m_requests[ticket].done; });
+    int result = m_requests[ticket].result;
+    m_free_slots.push_back(ticket);
+    slot_latch.unlock();
+    m_slot_cond.notify_all();
+    return result;
+}
+
+void AsyncIo::drain()
+{
+    std::unique_lock<std::mutex> slot_latch {m_slot_latch};
+    m_slot_cond.wait(slot_latch, [this]() { return m_in_flight == 0; });
+}
+
+// 请求完成, 在完成线程或线程池的工作线程中调用
+void AsyncIo::complete(int slot, int result, bool from_ring)
+{
+    Request &request = m_requests[slot];
+    bool write;
+    Callback callback;
+    std::chrono::steady_clock::time_point start;
+    {
+        std::lock_guard<std::mutex> slot_latch {m_slot_latch};
+        write = request.write;
+        start = request.start;
+        callback = std::move(request.callback);
+        request.callback = nullptr;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    if (from_ring) { // 从提交到完成的时间, 其中包括在内核队列中等待的时间
+        if (write) {
+            STATS_INC(WRITE_CALL);
+            STATS_INC(WRITE_PAGE);
+            STATS_RECORD(WRITE_LATENCY, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        } else {
+            STATS_INC(READ_CALL);
+            STATS_INC(READ_PAGE);
+            STATS_RECORD(READ_LATENCY, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+    }
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    int bucket = 0;
+    while (bucket < AIOBUCKETS - 1 && latency >= (1LL << bucket)) {
+        bucket++;
+    }
+    (write ? m_write_latency : m_read_latency)[bucket]++;
+    if (callback) {
+        callback(result);
+    }
+    {
+        std::lock_guard<std::mutex> slot_latch {m_slot_latch};
+        if (callback) {
+            m_free_slots.push_back(slot);
+        } else {
+            request.result = result;
+            request.done = true;
+        }
+        m_in_flight--;
+    }
+    m_slot_cond.notify_all();
+}
+
+bool AsyncIo::uring_setup()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    unsigned entries = 1;
+    while (entries < (unsigned)m_queue_depth) {
+        entries <<= 1;
+    }
+    m_ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (m_ring_fd < 0) {
+        return false;
+    }
+    m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size);
+    }
+    m_sq_ptr = mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+    if (m_sq_ptr == MAP_FAILED) {
+        close(m_ring_fd);
+        return false;
+    }
+    m_cq_ptr = single_mmap ? m_sq_ptr : mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_CQ_RING);
+    m_sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    m_sqes = static_cast<struct io_uring_sqe *>(mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES));
+    if (m_cq_ptr == MAP_FAILED || m_sqes == MAP_FAILED) {
+        if (m_cq_ptr != MAP_FAILED && m_cq_ptr != m_sq_ptr) {
+            munmap(m_cq_ptr, m_cq_size);
+        }
+        munmap(m_sq_ptr, m_sq_size);
+        close(m_ring_fd);
+        return false;
+    }
+    char *sq = static_cast<char *>(m_sq_ptr);
+    char *cq = static_cast<char *>(m_cq_ptr);
+    m_sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    m_sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    m_sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    m_sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    m_cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    m_cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    m_cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+    return true;
+}
+
+// 在途请求数不超过 queue_depth, 因而提交队列不会满.
+// 提交失败时撤回该请求, 改为同步读写: 没有 SQPOLL 时内核只在 io_uring_enter 中取走请求, 而提交都持有 m_sq_latch,
+// 所以 head 未越过它时可以安全地把 tail 退回
+void AsyncIo::uring_submit(int slot, int page_id, bool write)
+{
+    Request &request = m_requests[slot];
+    {
+        std::lock_guard<std::mutex> sq_latch {m_sq_latch};
+        unsigned tail = *m_sq_tail;
+        unsigned index = tail & *m_sq_mask;
+        struct io_uring_sqe *sqe = &m_sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = write ? IORING_OP_WRITEV : IORING_OP_READV;
+        sqe->fd = m_dsmgr->page_fd(page_id);
+        sqe->off = (uint64_t)m_dsmgr->page_offset(page_id);
+        sqe->addr = (uint64_t)(uintptr_t)&request.iov;
+        sqe->len = 1;
+        sqe->user_data = slot;
+        m_sq_array[index] = index;
+        __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+        if (uring_enter() || __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE) != tail) {
+            return;
+        }
+        __atomic_store_n(m_sq_tail, tail, __ATOMIC_RELEASE);
+    }
+    int result = write ? m_dsmgr->write_page(page_id, request.frame) : m_dsmgr->read_page(page_id, request.frame);
+    complete(slot, result);
+}
+
+// 提交队列中尚未被内核取走的请求, 调用者需持有 m_sq_latch. 被信号打断 (EINTR) 或内核暂时无法接收 (EAGAIN,
+// 完成队列满时的 EBUSY) 时重试, 至多 URINGRETRIES 次; 全部被取走返回 true
+bool AsyncIo::uring_enter()
+{
+    for (int retry = 0; ; retry++) {
+        unsigned pending = __atomic_load_n(m_sq_tail, __ATOMIC_RELAXED) - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+        if (pending == 0) {
+            return true;
+        }
+        long ret = syscall(__NR_io_uring_enter, m_ring_fd, pending, 0, 0, nullptr, 0);
+        if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            return false;
+        }
+        if (retry >= URINGRETRIES) {
+            return false;
+        }
+        if (ret <= 0) {
+            std::this_thread::yield(); // 等完成线程取走完成事件
+        }
+    }
+}
+
+// 完成线程: 等待并分发完成事件
+void AsyncIo::uring_reap()
+{
+    int page_size = m_dsmgr->get_page_size();
+    while (true) {
+        unsigned head = *m_cq_head;
+        if (head == __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE)) {
+            long ret = syscall(__NR_io_uring_enter, m_ring_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                std::this_thread::yield(); // 无法在内核中等待, 退化为轮询完成队列
+            }
+            continue;
+        }
+        struct io_uring_cqe cqe = m_cqes[head & *m_cq_mask];
+        __atomic_store_n(m_cq_head, head + 1, __ATOMIC_RELEASE);
+        if (cqe.user_data == URING_STOP) {
+            return;
+        }
+        m_dsmgr->io_count++;
+        complete((int)cqe.user_data, cqe.res == page_size, true);
+    }
+}
+
+// 线程池的工作线程
+void AsyncIo::pool_work()
+{
+    while (true) {
+        int slot;
+        {
+            std::unique_lock<std::mutex> slot_latch {m_slot_latch};
+            m_pending_cond.wait(slot_latch, [this]() { return m_stop || !m_pending.empty(); });
+            if (m_pending.empty()) {
+                return;
+            }
+            slot = m_pending.front();
+            m_pending.pop_front();
+        }
+        Request &request = m_requests[slot];
+        int result = request.write ? m_dsmgr->write_page(request.page_id, request.frame)
+            : m_dsmgr->read_page(request.page_id, request.frame);
+        complete(slot, result);
+    }
+}
+
+void AsyncIo::print_stats(std::ostream &out) const
+{
+    long long requests = m_reads + m_writes;
+    out << "    aio engine: " << (m_engine == IO_URING ? "io_uring" : "thread pool") << std::endl
+        << "    aio reads: " << m_reads << ", writes: " << m_writes << std::endl
+        << "    aio queue depth: avg " << (requests ? (double)m_depth_sum / requests : 0.0)
+        << ", max " << m_max_depth << std::endl;
+    const std::atomic<long long> *histograms[2] = {m_read_latency, m_write_latency};
+    const char *names[2] = {"read", "write"};
+    for (int h = 0; h < 2; h++) {
+        out << "    aio " << names[h] << " latency (us):";
+        for (int i = 0; i < AIOBUCKETS; i++) {
+            if (histograms[h][i] > 0) {
+                out << " <" << (1LL << i) << ": " << histograms[h][i];
+            }
+        }
+        out << std::endl;
+    }
+}
@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "compressed_cache.h"
+
+static uint32_t read32(const unsigned char *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint64_t read64(const unsigned char *p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// 从 a 与 b 开始相同的字节数, 不超过 limit, 每次比较 8 字节
+static int common_length(const unsigned char *a, const unsigned char *b, int limit)
+{
+    int length = 0;
+    while (length + 8 <= limit) {
+        uint64_t diff = read64(a + length) ^ read64(b + length);
+        if (diff != 0) {
+            return length + __builtin_ctzll(diff) / 8; // 小端
+        }
+        length += 8;
+    }
+    while (length < limit && a[length] == b[length]) {
+        length++;
+    }
+    return length;
+}
+
+static uint32_t lz_hash(uint32_t sequence)
+{
+    return (sequence * 2654435761U) >> (32 - LZHASHBITS);
+}
+
+// 写入 token 之后的长度扩展字节, 返回新的输出位置, 超过 end 时返回 nullptr
+static unsigned char *write_length(unsigned char *op, unsigned char *end, int length)
+{
+    for (; length >= 255; length -= 255) {
+        if (op >= end) {
+            return nullptr;
+        }
+        *op++ = 255;
+    }
+    if (op >= end) {
+        return nullptr;
+    }
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+// 输出一个序列, match_length 为 0 时为只有字面量的最后一个序列
+static unsigned char *write_sequence(unsigned char *op, unsigned char *end, const unsigned char *literals, int literal_length,
+    int offset, int match_length)
+{
+    if (op >= end) {
+        return nullptr;
+    }
+    unsigned char *token = op++;
+    *token = (unsigned char)((literal_length >= 15 ? 15 : literal_length) << 4);
+    if (literal_length >= 15 && (op = write_length(op, end, literal_length - 15)) == nullptr) {
+        return nullptr;
+    }
+    if (end - op < literal_length) {
+        return nullptr;
+    }
+    memcpy(op, literals, literal_length);
+    op += literal_length;
+    if (match_length == 0) {
+        return op;
+    }
+    if (end - op < 2) {
+        return nullptr;
+    }
+    *op++ = (unsigned char)(offset & 0xff);
+    *op++ = (unsigned char)(offset >> 8);
+    int length = match_length - LZMINMATCH;
+    *token |= (unsigned char)(length >= 15 ? 15 : length);
+    if (length >= 15 && (op = write_length(op, end, length - 15)) == nullptr) {
+        return nullptr;
+    }
+    return op;
+}
+
+// 贪心匹配: 用 4 字节序列的哈希表记录最近出现的位置, 只在哈希表命中且 4 字节相同时开始匹配.
+// 哈希表只保存位置的低 16 位, 由当前位置推算出 65535 以内的候选位置, 未初始化的项 (0) 只会产生被校验排除的候选
+int lz_compress(const char *src, int size, char *dst, int capacity)
+{
+    const unsigned char *in = (const unsigned char *)src;
+    unsigned char *op = (unsigned char *)dst, *end = op + capacity;
+    uint16_t table[1 << LZHASHBITS];
+    memset(table, 0, sizeof(table));
+    int anchor = 0;
+    for (int ip = 0; ip < size - LZMFLIMIT; ) {
+        uint32_t sequence = read32(in + ip);
+        uint32_t h = lz_hash(sequence);
+        int ref = ip - (uint16_t)(ip - table[h]);
+        table[h] = (uint16_t)ip;
+        if (ref < 0 || ref == ip || read32(in + ref) != sequence) {
+            ip++;
+            continue;
+        }
+        int length = LZMINMATCH + common_length(in + ref + LZMINMATCH, in + ip + LZMINMATCH, size - LZLASTLITERALS - ip - LZMINMATCH);
+        op = write_sequence(op, end, in + anchor, ip - anchor, ip - ref, length);
+        if (op == nullptr) {
+            return -1;
+        }
+        ip += length;
+        anchor = ip;
+    }
+    op = write_sequence(op, end, in + anchor, size - anchor, 0, 0);
+    return op == nullptr ? -1 : (int)(op - (unsigned char *)dst);
+}
+
+int lz_decompress(const char *src, int size, char *dst, int capacity)
+{
+    const unsigned char *ip = (const unsigned char *)src, *in_end = ip + size;
+    unsigned char *op = (unsigned char *)dst, *out = op, *end = op + capacity;
+    while (ip < in_end) {
+        int token = *ip++;
+        int literal_length = token >> 4;
+        if (literal_length == 15) {
+            int b;
+            do {
+                if (ip >= in_end) {
+                    return -1;
+                }
+                b = *ip++;
+                literal_length += b;
+            } while (b == 255);
+        }
+        if (in_end - ip < literal_length || end - op < literal_length) {
+            return -1;
+        }
+        memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+        if (ip == in_end) { // 最后一个序列
+            break;
+        }
+        if (in_end - ip < 2) {
+            return -1;
+        }
+        int offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op - out) {
+            return -1;
+        }
+        int match_length = token & 15;
+        if (match_length == 15) {
+            int b;
+            do {
+                if (ip >= in_end) {
+                    return -1;
+                }
+                b = *ip++;
+                match_length += b;
+            } while (b == 255);
+        }
+        match_length += LZMINMATCH;
+        if (end - op < match_length) {
+            return -1;
+        }
+        // 匹配可能与输出重叠 (offset 小于长度): 每次复制不超过 op - match 字节, 源与目标不重叠,
+        // 复制的内容仍以 offset 为周期, 所以之后每次可以复制的长度翻倍
+        const unsigned char *match = op - offset;
+        while (match_length > 0) {
+            int chunk = std::min(match_length, (int)(op - match));
+            memcpy(op, match, chunk);
+            op += chunk;
+            match_length -= chunk;
+        }
+    }
+    return (int)(op - out);
+}
+
+CompressedCache::CompressedCache(size_t budget, int page_size):
+    put_count(0), reject_count(0), hit_count(0), miss_count(0), evict_count(0),
+    m_budget(budget), m_page_size(page_size), m_used(0), m_raw_bytes(0), m_compressed_bytes(0)
+{
+}
+
+void CompressedCache::put(int page_id, const char *page)
+{
+    int capacity = m_page_size - m_page_size / 8;
+    std::unique_ptr<char[]> buffer {new char[capacity]};
+    int size = lz_compress(page, m_page_size, buffer.get(), capacity);
+    if (size < 0) {
+        reject_count++;
+        erase(page_id); // 已有的条目已经过时
+        return;
+    }
+    std::unique_ptr<char[]> data {new char[size]};
+    memcpy(data.get(), buffer.get(), size);
+    put_count++;
+    m_raw_bytes += m_page_size;
+    m_compressed_bytes += size;
+    std::lock_guard<std::mutex> latch {m_latch};
+    auto it = m_index.find(page_id);
+    if (it != m_index.end()) {
+        erase_locked(it);
+    }
+    m_lru.push_front({page_id, size, std::move(data)});
+    m_index[page_id] = m_lru.begin();
+    m_used += size + TIER2OVERHEAD;
+    while (m_used > m_budget && !m_lru.empty()) {
+        evict_count++;
+        erase_locked(m_index.find(m_lru.back().page_id));
+    }
+}
+
+bool CompressedCache::get(int page_id, char *page)
+{
+    Entry entry;
+    {
+        std::lock_guard<std::mutex> latch {m_latch};
+        auto it = m_index.find(page_id);
+        if (it == m_index.end()) {
+            miss_count++;
+            return false;
+        }
+        entry = std::move(*it->second);
+        m_used -= entry.size + TIER2OVERHEAD;
+        m_lru.erase(it->second);
+        m_index.erase(it);
+    }
+    if (lz_decompress(entry.data.get(), entry.size, page, m_page_size) != m_page_size) {
+        miss_count++;
+        return false;
+    }
+    hit_count++;
+    return true;
+}
+
+void CompressedCache::erase(int page_id)
+{
+    std::lock_guard<std::mutex> latch {m_latch};
+    auto it = m_index.find(page_id);
+    if (it != m_index.end()) {
+        erase_locked(it);
+    }
+}
+
+void CompressedCache::erase_locked(std::unordered_map<int, std::list<Entry>::iterator>::iterator it)
+{
+    m_used -= it->second->size + TIER2OVERHEAD;
+    m_lru.erase(it->second);
+    m_index.erase(it);
+}
+
+void CompressedCache::print_stats(std::ostream &out) const
+{
+    long long hits = hit_count, lookups = hits + miss_count;
+    out << "    tier-2 budget: " << m_budget << " bytes, used: " << m_used << " bytes" << std::endl
+        << "    tier-2 puts: " << put_count << ", rejected: " << reject_count << ", evicted: " << evict_count << std::endl
+        << "    tier-2 compression ratio: " << (m_compressed_bytes > 0 ? (double)m_raw_bytes / m_compressed_bytes : 0) << std::endl
+        << "    tier-2 hit count: " << hits << std::endl
+        << "    tier-2 hit rate: " << (lookups > 0 ? (double)hits / lookups : 0) << std::endl;
+}
@@ -1,70 +1,481 @@
+#include <cstdlib>
 #include <cstring>
+#include <algorithm>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include "data_storage.h"
+#include "stats.h"
 
-static const char page_default_content[PAGESIZE] = {0};
+// 分配按 DIRECTALIGN 对齐并清零的内存, 大小向上取整到 DIRECTALIGN 的倍数
+static char *alloc_aligned(size_t size)
+{
+    size = (size + DIRECTALIGN - 1) / DIRECTALIGN * DIRECTALIGN;
+    char *buffer = static_cast<char *>(aligned_alloc(DIRECTALIGN, size));
+    memset(buffer, 0, size);
+    return buffer;
+}
+
+DataStorageManager::DataStorageManager(int page_size, int max_pages):
+    io_count(0), m_io_mode(STDIO), m_num_files(1), m_stripe_pages(STRIPEPAGES), m_page_size(page_size), m_max_pages(max_pages),
+    m_num_pages(0), m_header(nullptr)
+{
+    m_page_default_content = alloc_aligned(page_size);
+    format();
+}
+
+DataStorageManager::~DataStorageManager()
+{
+    close_all();
+    free(m_page_default_content);
+    free(m_header);
+}
+
+// 按 m_max_pages 重新分配空的 header, 所有 page 都不在使用
+void DataStorageManager::format()
+{
+    size_t words = ((size_t)m_max_pages + 63) / 64;
+    size_t bytes = sizeof(SpaceHeader) + words * sizeof(uint64_t);
+    m_header_pages = (int)((bytes + m_page_size - 1) / m_page_size);
+    free(m_header);
+    m_header = alloc_aligned((size_t)m_header_pages * m_page_size);
+    SpaceHeader *header = reinterpret_cast<SpaceHeader *>(m_header);
+    memcpy(header->magic, SPACEMAGIC, sizeof(header->magic));
+    header->max_pages = m_max_pages;
+    header->num_pages = 0;
+    header->num_files = m_num_files;
+    header->stripe_pages = m_stripe_pages;
+    m_header_dirty.assign(m_header_pages, 1);
+    m_num_pages = 0;
+    m_num_used = 0;
+    m_alloc_hint = 0;
+}
+
+// 从第一个文件的开头读入 size 字节, buffer 按 DIRECTALIGN 对齐, 读不满时返回 -1
+int DataStorageManager::read_header(char *buffer, size_t size)
+{
+    DataFile *file = m_files[0];
+    int ok;
+    if (m_io_mode != STDIO) {
+        ok = pread(file->fd, buffer, size, 0) == (ssize_t)size;
+    } else {
+        fseek(file->file, 0, SEEK_SET);
+        ok = fread(buffer, size, 1, file->file) == 1;
+    }
+    return ok ? 0 : -1;
+}
+
+// 从第一个文件读入文件头, 文件没有文件头时返回 -1
+int DataStorageManager::load_header()
+{
+    SpaceHeader header;
+    char *first = alloc_aligned(m_page_size);
+    int ok = read_header(first, m_page_size) == 0;
+    memcpy(&header, first, sizeof(header));
+    if (ok && memcmp(header.magic, SPACEMAGICV1, sizeof(header.magic)) == 0) {
+        int upgraded = upgrade_header(first);
+        free(first);
+        return upgraded;
+    }
+    free(first);
+    if (!ok || memcmp(header.magic, SPACEMAGIC, sizeof(header.magic)) != 0 || header.max_pages <= 0
+        || header.num_pages < 0 || header.num_pages > header.max_pages || header.num_files <= 0 || header.stripe_pages <= 0) {
+        return -1;
+    }
+    m_max_pages = header.max_pages;
+    m_stripe_pages = header.stripe_pages;
+    format();
+    if (read_header(m_header, (size_t)m_header_pages * m_page_size) < 0) {
+        return -1;
+    }
+    m_header_dirty.assign(m_header_pages, 0);
+    m_num_pages = reinterpret_cast<SpaceHeader *>(m_header)->num_pages;
+    if (header.num_files != m_num_files) {
+        return -2;
+    }
+    const uint64_t *words = bitmap();
+    for (int i = 0; i < (m_num_pages + 63) / 64; i++) {
+        m_num_used += __builtin_popcountll(words[i]);
+    }
+    return 0;
+}
+
+// 将旧的 ADBSPACE 文件头升级为当前格式: 位图从旧文件头之后移到新文件头之后, 其余 header page 不变.
+// 新文件头多出的字段使 header page 数增加时, 第一个 page 的位置会改变, 不能原地升级, 返回 -1
+int DataStorageManager::upgrade_header(const char *first)
+{
+    struct SpaceHeaderV1 {
+        char magic[8];
+        int32_t max_pages;
+        int32_t num_pages;
+    } header;
+    memcpy(&header, first, sizeof(header));
+    if (header.max_pages <= 0 || header.num_pages < 0 || header.num_pages > header.max_pages) {
+        return -1;
+    }
+    if (m_num_files != 1) { // 旧文件头只用于单文件
+        return -2;
+    }
+    m_max_pages = header.max_pages;
+    format();
+    size_t words = ((size_t)m_max_pages + 63) / 64;
+    size_t old_bytes = sizeof(SpaceHeaderV1) + words * sizeof(uint64_t);
+    if ((int)((old_bytes + m_page_size - 1) / m_page_size) != m_header_pages) {
+        return -1;
+    }
+    char *old = alloc_aligned((size_t)m_header_pages * m_page_size);
+    if (read_header(old, (size_t)m_header_pages * m_page_size) < 0) {
+        free(old);
+        return -1;
+    }
+    memcpy(bitmap(), old + sizeof(SpaceHeaderV1), words * sizeof(uint64_t));
+    free(old);
+    m_num_pages = header.num_pages;
+    const uint64_t *bits = bitmap();
+    for (int i = 0; i < (m_num_pages + 63) / 64; i++) {
+        m_num_used += __builtin_popcountll(bits[i]);
+    }
+    return write_header(); // format 已将所有 header page 标记为 dirty
+}
+
+// 将 dirty 的 header page 写回第一个文件
+int DataStorageManager::write_header()
+{
+    reinterpret_cast<SpaceHeader *>(m_header)->num_pages = m_num_pages;
+    m_header_dirty[0] = 1;
+    if (m_io_mode == NONE) {
+        return 0;
+    }
+    DataFile *file = m_files[0];
+    int ok = 1;
+    for (int i = 0; i < m_header_pages; i++) {
+        if (!m_header_dirty[i]) {
+            continue;
+        }
+        const char *page = m_header + (size_t)i * m_page_size;
+        if (m_io_mode != STDIO) {
+            ok = ok && pwrite(file->fd, page, m_page_size, (off_t)i * m_page_size) == m_page_size;
+        } else {
+            std::lock_guard<std::mutex> file_latch {file->latch};
+            fseek(file->file, (long)i * m_page_size, SEEK_SET);
+            ok = ok && fwrite(page, m_page_size, 1, file->file) == 1;
+        }
+        m_header_dirty[i] = 0;
+    }
+    return ok ? 0 : -1;
+}
 
-DataStorageManager::DataStorageManager(): m_curr_file(nullptr), m_num_pages(0), io_count(0)
+int DataStorageManager::open_file(std::string filename, IoMode mode)
 {
-    memset(m_pages, 0, MAXPAGES * sizeof(int));
+    return open_files({filename}, mode);
 }
 
+// 打开一个文件加入 m_files, 返回其长度, 失败时返回 -1. O_DIRECT 打开失败时该文件与之后的文件都以 PREAD 方式打开
+int DataStorageManager::open_one(const std::string &filename, IoMode mode)
+{
+    long length;
+    FILE *file = nullptr;
+    int fd = -1;
+    if (mode == STDIO) {
+        file = fopen(filename.c_str(), "r+b");
+        if (!file) {
+            file = fopen(filename.c_str(), "w+b");
+        }
+        if (!file) {
+            return -1;
+        }
+        fseek(file, 0, SEEK_END);
+        length = ftell(file);
+    } else {
+        int flags = O_RDWR | O_CREAT;
+        if (mode == DIRECT && m_page_size % DIRECTALIGN == 0) {
+            fd = open(filename.c_str(), flags | O_DIRECT, 0644);
+        }
+        if (fd < 0) {
+            m_io_mode = PREAD;
+            fd = open(filename.c_str(), flags, 0644);
+        }
+        if (fd < 0) {
+            return -1;
+        }
+        struct stat st;
+        fstat(fd, &st);
+        length = st.st_size;
+    }
+    DataFile *data_file = new DataFile;
+    data_file->file = file;
+    data_file->fd = fd;
+    m_files.push_back(data_file);
+    return length;
+}
 
-int DataStorageManager::open_file(std::string filename)
+int DataStorageManager::open_files(const std::vector<std::string> &filenames, IoMode mode)
 {
-    m_curr_file = fopen(filename.c_str(), "r+b");
-    if (!m_curr_file) {
-        m_curr_file = fopen(filename.c_str(), "w+b");
+    m_io_mode = mode;
+    m_num_files = std::max((int)filenames.size(), 1);
+    if (mode == NONE) {
+        std::lock_guard<std::mutex> space_latch {m_space_latch};
+        format();
+        return 1;
+    }
+    long length = 0;
+    bool empty = true; // 所有文件都为空 (新建的文件)
+    for (size_t i = 0; i < filenames.size(); i++) {
+        long file_length = open_one(filenames[i], m_io_mode);
+        if (file_length < 0) {
+            close_all();
+            return 0;
+        }
+        if (i == 0) {
+            length = file_length;
+        }
+        empty = empty && file_length == 0;
     }
-    fseek(m_curr_file, 0, SEEK_END);
-    auto length = ftell(m_curr_file);
-    m_num_pages = length / PAGESIZE;
-    // 没有文件格式, 无法得知元信息, 则默认全部为 use
-    memset(m_pages, 0, MAXPAGES * sizeof(int));
-    for (int i = 0; i < m_num_pages; i++) {
-        set_use(i, 1);
+    if (m_files.empty()) {
+        return 0;
     }
-    return m_curr_file != nullptr;
+    std::lock_guard<std::mutex> space_latch {m_space_latch};
+    int loaded = length == 0 ? -1 : load_header();
+    if (loaded == -2) { // 文件数与表空间不一致, 不能按条带找到已有的 page
+        close_all();
+        return 0;
+    }
+    if (loaded < 0 && !empty) {
+        // 有内容但没有可识别的文件头 (例如最初没有文件头的格式), 格式化会丢失其中的 page, 拒绝打开
+        close_all();
+        return 0;
+    }
+    if (loaded < 0) {
+        // 新建的空文件, 格式化为第一个文件只有 header 的空表空间
+        format();
+        if (write_header() < 0) {
+            close_all();
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void DataStorageManager::close_all()
+{
+    for (DataFile *file : m_files) {
+        if (file->file) {
+            fclose(file->file);
+        }
+        if (file->fd >= 0) {
+            close(file->fd);
+        }
+        delete file;
+    }
+    m_files.clear();
 }
 
 int DataStorageManager::close_file()
 {
-    fclose(m_curr_file);
-    m_curr_file = nullptr;
+    {
+        std::lock_guard<std::mutex> space_latch {m_space_latch};
+        if (!m_files.empty()) {
+            write_header();
+        }
+    }
+    close_all();
     m_num_pages = 0;
     return 0;
 }
 
+off_t DataStorageManager::page_offset(int page_id) const
+{
+    int stripe = page_id / m_stripe_pages;
+    off_t page = (off_t)(stripe / m_num_files) * m_stripe_pages + page_id % m_stripe_pages;
+    if (stripe % m_num_files == 0) { // 第一个文件的 header page 之后
+        page += m_header_pages;
+    }
+    return page * m_page_size;
+}
+
+int DataStorageManager::run_length(int page_id, int num_pages) const
+{
+    int n = std::min(num_pages, IOV_MAX);
+    return m_num_files == 1 ? n : std::min(n, m_stripe_pages - page_id % m_stripe_pages);
+}
+
 int DataStorageManager::read_page(int page_id, char *frame)
 {
-    fseek(m_curr_file, page_id * PAGESIZE, SEEK_SET);
+    STATS_SCOPE(READ_LATENCY);
+    STATS_INC(READ_CALL);
+    STATS_INC(READ_PAGE);
     io_count++;
-    return fread(frame, PAGESIZE, 1, m_curr_file);
+    if (m_io_mode == NONE) {
+        return 1;
+    }
+    DataFile *file = m_files[file_index(page_id)];
+    if (m_io_mode != STDIO) {
+        return pread(file->fd, frame, m_page_size, page_offset(page_id)) == m_page_size;
+    }
+    std::lock_guard<std::mutex> file_latch {file->latch};
+    fseek(file->file, (long)page_offset(page_id), SEEK_SET);
+    return fread(frame, m_page_size, 1, file->file);
+}
+
+// 按条带拆分为在同一文件中连续的段, 每段至多 IOV_MAX 个 page, 计为一次 I/O:
+// PREAD/DIRECT 方式下用 preadv 一次读入; STDIO 方式下只 fseek 一次, 之后逐个 fread. 全部读入成功返回 1
+int DataStorageManager::read_pages(int first_page_id, char *const *frames, int num_pages)
+{
+    STATS_SCOPE(READ_LATENCY);
+    STATS_INC(READ_CALL);
+    STATS_ADD(READ_PAGE, num_pages);
+    int ok = 1;
+    struct iovec iov[IOV_MAX];
+    for (int done = 0; done < num_pages; ) {
+        int page_id = first_page_id + done;
+        int n = run_length(page_id, num_pages - done);
+        io_count++;
+        if (m_io_mode == NONE) {
+            done += n;
+            continue;
+        }
+        DataFile *file = m_files[file_index(page_id)];
+        if (m_io_mode != STDIO) {
+            for (int i = 0; i < n; i++) {
+                iov[i].iov_base = frames[done + i];
+                iov[i].iov_len = m_page_size;
+            }
+            ssize_t bytes = preadv(file->fd, iov, n, page_offset(page_id));
+            ok = ok && bytes == (ssize_t)n * m_page_size;
+        } else {
+            std::lock_guard<std::mutex> file_latch {file->latch};
+            fseek(file->file, (long)page_offset(page_id), SEEK_SET);
+            for (int i = 0; i < n; i++) {
+                ok = ok && fread(frames[done + i], m_page_size, 1, file->file) == 1;
+            }
+        }
+        done += n;
+    }
+    return ok;
+}
+
+// 与 read_pages 相同, PREAD/DIRECT 方式下用 pwritev, 全部写入成功返回 1
+int DataStorageManager::write_pages(int first_page_id, const char *const *frames, int num_pages)
+{
+    STATS_SCOPE(WRITE_LATENCY);
+    STATS_INC(WRITE_CALL);
+    STATS_ADD(WRITE_PAGE, num_pages);
+    int ok = 1;
+    struct iovec iov[IOV_MAX];
+    for (int done = 0; done < num_pages; ) {
+        int page_id = first_page_id + done;
+        int n = run_length(page_id, num_pages - done);
+        io_count++;
+        if (m_io_mode == NONE) {
+            done += n;
+            continue;
+        }
+        DataFile *file = m_files[file_index(page_id)];
+        if (m_io_mode != STDIO) {
+            for (int i = 0; i < n; i++) {
+                iov[i].iov_base = const_cast<char *>(frames[done + i]);
+                iov[i].iov_len = m_page_size;
+            }
+            ssize_t bytes = pwritev(file->fd, iov, n, page_offset(page_id));
+            ok = ok && bytes == (ssize_t)n * m_page_size;
+        } else {
+            std::lock_guard<std::mutex> file_latch {file->latch};
+            fseek(file->file, (long)page_offset(page_id), SEEK_SET);
+            for (int i = 0; i < n; i++) {
+                ok = ok && fwrite(frames[done + i], m_page_size, 1, file->file) == 1;
+            }
+        }
+        done += n;
+    }
+    return ok;
+}
+
+int DataStorageManager::sync()
+{
+    {
+        std::lock_guard<std::mutex> space_latch {m_space_latch};
+        if (write_header() < 0) {
+            return -1;
+        }
+    }
+    int ret = 0;
+    for (DataFile *file : m_files) {
+        if (m_io_mode != STDIO) {
+            ret = fsync(file->fd) < 0 ? -1 : ret;
+            continue;
+        }
+        std::lock_guard<std::mutex> file_latch {file->latch};
+        if (fflush(file->file) != 0 || fsync(fileno(file->file)) < 0) {
+            ret = -1;
+        }
+    }
+    return ret;
 }
 
 int DataStorageManager::write_page(int page_id, const char *frame)
 {
-    fseek(m_curr_file, page_id * PAGESIZE, SEEK_SET);
+    STATS_SCOPE(WRITE_LATENCY);
+    STATS_INC(WRITE_CALL);
+    STATS_INC(WRITE_PAGE);
     io_count++;
-    return fwrite(frame, PAGESIZE, 1, m_curr_file);
+    if (m_io_mode == NONE) {
+        return 1;
+    }
+    DataFile *file = m_files[file_index(page_id)];
+    if (m_io_mode != STDIO) {
+        return pwrite(file->fd, frame, m_page_size, page_offset(page_id)) == m_page_size;
+    }
+    std::lock_guard<std::mutex> file_latch {file->latch};
+    fseek(file->file, (long)page_offset(page_id), SEEK_SET);
+    return fwrite(frame, m_page_size, 1, file->file);
 }
 
 int DataStorageManager::seek(int offset, int pos)
 {
-    return fseek(m_curr_file, offset, pos);
+    if (m_files.empty()) {
+        return 0;
+    }
+    if (m_io_mode != STDIO) {
+        return lseek(m_files[0]->fd, offset, pos) < 0 ? -1 : 0;
+    }
+    return fseek(m_files[0]->file, offset, pos);
 }
 
 FILE* DataStorageManager::get_file()
 {
-    return m_curr_file;
+    return m_files.empty() ? nullptr : m_files[0]->file;
+}
+
+int DataStorageManager::inc_num_pages()
+{
+    std::lock_guard<std::mutex> space_latch {m_space_latch};
+    return extend_locked() < 0 ? -1 : 0;
 }
 
-void DataStorageManager::inc_num_pages()
+// 在表空间末尾追加一个全 0 的 page 并标记为使用, 返回其 page_id; 该 page 追加在其条带所在文件的末尾.
+// 调用者需持有 m_space_latch
+int DataStorageManager::extend_locked()
 {
+    if (m_num_pages >= m_max_pages) {
+        return -1;
+    }
+    int page_id = m_num_pages;
+    if (m_io_mode != NONE) {
+        DataFile *file = m_files[file_index(page_id)];
+        if (m_io_mode != STDIO) {
+            pwrite(file->fd, m_page_default_content, m_page_size, page_offset(page_id));
+        } else {
+            std::lock_guard<std::mutex> file_latch {file->latch};
+            fseek(file->file, (long)page_offset(page_id), SEEK_SET);
+            fwrite(m_page_default_content, m_page_size, 1, file->file);
+        }
+    }
     m_num_pages++;
-    fseek(m_curr_file, 0, SEEK_END);
-    fwrite(page_default_content, PAGESIZE, 1, m_curr_file);
-    set_use(m_num_pages - 1, 1);
+    set_use_locked(page_id, 1);
     io_count++;
+    return page_id;
 }
 
 int DataStorageManager::get_num_pages()
@@ -72,13 +483,64 @@ int DataStorageManager::get_num_pages()
     return m_num_pages;
 }
 
+int DataStorageManager::allocate_page()
+{
+    std::lock_guard<std::mutex> space_latch {m_space_latch};
+    if (m_num_used < m_num_pages) { // 有空闲的 page, 从 hint 开始查找, 至多绕回一圈
+        const uint64_t *words = bitmap();
+        int num_words = (m_num_pages + 63) / 64;
+        for (int n = 0; n < num_words; n++) {
+            int w = (m_alloc_hint + n) % num_words;
+            uint64_t free_bits = ~words[w];
+            if (free_bits == 0) {
+                continue;
+            }
+            int page_id = w * 64 + __builtin_ctzll(free_bits);
+            if (page_id >= m_num_pages) { // 最后一个字中超出文件的位
+                continue;
+            }
+            m_alloc_hint = w;
+            set_use_locked(page_id, 1);
+            return page_id;
+        }
+    }
+    // 所有 page 都在使用, 直接扩展文件
+    return extend_locked();
+}
+
+int DataStorageManager::free_page(int page_id)
+{
+    std::lock_guard<std::mutex> space_latch {m_space_latch};
+    if (page_id < 0 || page_id >= m_num_pages || !(bitmap()[page_id / 64] >> (page_id % 64) & 1)) {
+        return -1;
+    }
+    set_use_locked(page_id, 0);
+    m_alloc_hint = page_id / 64;
+    return 0;
+}
+
 void DataStorageManager::set_use(int index, int use_bit)
 {
-    m_pages[index] = use_bit;
+    std::lock_guard<std::mutex> space_latch {m_space_latch};
+    set_use_locked(index, use_bit);
 }
 
-int DataStorageManager::get_use(int index)
+// 修改位图中的一位并标记所在的 header page 为 dirty, 调用者需持有 m_space_latch
+void DataStorageManager::set_use_locked(int index, int use_bit)
 {
-    return m_pages[index];
+    uint64_t &word = bitmap()[index / 64];
+    uint64_t mask = 1ULL << (index % 64);
+    if (!(word & mask) == !use_bit) {
+        return;
+    }
+    word ^= mask;
+    m_num_used += use_bit ? 1 : -1;
+    size_t offset = sizeof(SpaceHeader) + (size_t)(index / 64) * sizeof(uint64_t);
+    m_header_dirty[offset / m_page_size] = 1;
 }
 
+int DataStorageManager::get_use(int index)
+{
+    std::lock_guard<std::mutex> space_latch {m_space_latch};
+    return bitmap()[index / 64] >> (index % 64) & 1;
+}
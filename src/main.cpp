@@ -1,75 +1,654 @@
+#include <atomic>
 #include <iostream>
 #include <string>
 #include <chrono>
 #include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include "async_io.h"
 #include "data_storage.h"
 #include "buffer.h"
+#include "options.h"
+#include "replacers.h"
+#include "simulator.h"
+#include "trace.h"
 
 #define NUM_PAGES 50000
 
+static bool parse_io_mode(const std::string &name, DataStorageManager::IoMode &mode)
+{
+    if (name == "stdio") {
+        mode = DataStorageManager::STDIO;
+    } else if (name == "pread") {
+        mode = DataStorageManager::PREAD;
+    } else if (name == "direct") {
+        mode = DataStorageManager::DIRECT;
+    } else if (name == "none") {
+        mode = DataStorageManager::NONE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// 解析带 K/M/G 后缀的字节数, 或者 "N%" 表示当前可用物理内存的百分比
+static bool parse_size(const std::string &text, long long &bytes)
+{
+    char *end = nullptr;
+    double value = strtod(text.c_str(), &end);
+    if (end == text.c_str() || value <= 0) {
+        return false;
+    }
+    std::string suffix = end;
+    if (suffix == "%") {
+        long long avail = (long long)sysconf(_SC_AVPHYS_PAGES) * sysconf(_SC_PAGE_SIZE);
+        bytes = (long long)(avail * value / 100);
+        return true;
+    }
+    long long unit = 1;
+    if (suffix == "K" || suffix == "k") {
+        unit = 1LL << 10;
+    } else if (suffix == "M" || suffix == "m") {
+        unit = 1LL << 20;
+    } else if (suffix == "G" || suffix == "g") {
+        unit = 1LL << 30;
+    } else if (!suffix.empty()) {
+        return false;
+    }
+    bytes = (long long)(value * unit);
+    return true;
+}
+
+// 回放 trace 中下标为 start, start + step, ... 的访问, 返回因缓冲区耗尽 (所有 frame 都被 pin 住) 而失败的次数
+// prefetch_ahead 不为 0 时访问前先预取之后第 prefetch_ahead 个将要访问的 page;
+// pins 不为 0 时最近访问的 pins 个 page 保持 pin 住, 模拟调用者同时持有多个 page
+template <typename Manager>
+static int replay(Manager *bufmgr, const Trace &trace, size_t start, size_t step, int prefetch_ahead, int pins)
+{
+    std::deque<int> pinned;
+    int exhausted = 0;
+    size_t ahead = (size_t)prefetch_ahead * step;
+    for (size_t i = start; i < trace.size(); i += step) {
+        if (prefetch_ahead > 0 && i + ahead < trace.size()) {
+            bufmgr->prefetch_page(trace.page_id(i + ahead));
+        }
+        if (bufmgr->fix_page(trace.page_id(i), trace.write(i)) < 0) {
+            exhausted++;
+        } else if (pins > 0) {
+            pinned.push_back(trace.page_id(i));
+        } else {
+            bufmgr->unfix_page(trace.page_id(i));
+        }
+        while ((int)pinned.size() > pins) {
+            bufmgr->unfix_page(pinned.front());
+            pinned.pop_front();
+        }
+    }
+    for (int page_id : pinned) {
+        bufmgr->unfix_page(page_id);
+    }
+    return exhausted;
+}
+
+// 以 fix_pages 按每 window 个访问一批回放 trace 中下标为 start, start + step, ... 的访问, 每批访问完后全部 unfix,
+// 返回失败的访问数
+template <typename Manager>
+static int replay_windows(Manager *bufmgr, const Trace &trace, size_t start, size_t step, int window)
+{
+    std::vector<PageRequest> requests;
+    int exhausted = 0;
+    for (size_t i = start; i < trace.size(); ) {
+        requests.clear();
+        for (; i < trace.size() && (int)requests.size() < window; i += step) {
+            requests.push_back({trace.page_id(i), trace.write(i) != 0, -1});
+        }
+        exhausted += bufmgr->fix_pages(requests);
+        for (const PageRequest &request : requests) {
+            if (request.frame_id >= 0) {
+                bufmgr->unfix_page(request.page_id);
+            }
+        }
+    }
+    return exhausted;
+}
+
+// 2Q 的参数扫描: 对每组 Kin/Kout 用新的 BufferManager 回放一遍 trace, 输出命中率
+static void sweep_2q(DataStorageManager *dsmgr, const Trace &trace, int num_frames, ReplacerParams params)
+{
+    const double kins[] = {0.01, 0.02, 0.05, 0.1, 0.15, 0.2, 0.25, 0.3, 0.4, 0.5};
+    const double kouts[] = {0.1, 0.25, 0.5, 0.75, 1.0, 1.5, 2.0};
+    double best_rate = 0, best_kin = 0, best_kout = 0;
+    std::cout << "kin,kout,hit count,hit rate" << std::endl;
+    for (double kin : kins) {
+        for (double kout : kouts) {
+            params.kin = kin;
+            params.kout = kout;
+            auto *bufmgr = new BufferManager {dsmgr, Replacer::TWO_QUEUE, num_frames, false, params};
+            replay(bufmgr, trace, 0, 1, 0, 0);
+            double hit_rate = static_cast<double>(bufmgr->hit_count) / trace.size();
+            std::cout << kin << "," << kout << "," << bufmgr->hit_count << "," << hit_rate << std::endl;
+            if (hit_rate > best_rate) {
+                best_rate = hit_rate;
+                best_kin = kin;
+                best_kout = kout;
+            }
+            delete bufmgr;
+        }
+    }
+    std::cout << "best: kin " << best_kin << ", kout " << best_kout << ", hit rate " << best_rate << std::endl;
+}
+
+// 多线程回放: 第 t 个线程回放下标模 num_threads 余 t 的访问, 每个线程各自持有 pins 个 pin
+// window 不为 0 时每个线程各自按批回放
+template <typename Manager>
+static int replay_concurrent(Manager *bufmgr, const Trace &trace, int num_threads, int prefetch_ahead, int pins, int window)
+{
+    std::vector<std::thread> workers;
+    std::atomic<int> exhausted {0};
+    for (int t = 0; t < num_threads; t++) {
+        workers.emplace_back([bufmgr, &trace, &exhausted, num_threads, prefetch_ahead, pins, window, t]() {
+            if (window > 0) {
+                exhausted += replay_windows(bufmgr, trace, t, num_threads, window);
+            } else {
+                exhausted += replay(bufmgr, trace, t, num_threads, prefetch_ahead, pins);
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    return exhausted;
+}
+
+// 输出 before 与 after 两个快照之间的统计
+static void print_stats(const Stats::Snapshot &before, const Stats::Snapshot &after)
+{
+    Stats::Snapshot diff = after;
+    for (int i = 0; i < Stats::NUM_COUNTERS; i++) {
+        diff.counters[i] -= before.counters[i];
+    }
+    for (int h = 0; h < Stats::NUM_HISTOGRAMS; h++) {
+        for (int b = 0; b < STATSBUCKETS; b++) {
+            diff.histograms[h][b] -= before.histograms[h][b];
+        }
+    }
+    auto ratio = [](long long a, long long b) { return b == 0 ? 0.0 : (double)a / (double)b; };
+    auto latency = [&diff](Stats::Histogram histogram) {
+        return std::to_string(diff.percentile(histogram, 0.5)) + "/" + std::to_string(diff.percentile(histogram, 0.99)) + " ns";
+    };
+    std::cout << "    stats:" << std::endl
+        << "        fix latency p50/p99: " << latency(Stats::FIX_LATENCY) << std::endl
+        << "        miss latency p50/p99: " << latency(Stats::MISS_LATENCY) << std::endl
+        << "        evictions: " << diff.counters[Stats::EVICT] << " (dirty " << diff.counters[Stats::DIRTY_EVICT] << ")" << std::endl
+        << "        hash probes per lookup: " << ratio(diff.counters[Stats::PROBE], diff.counters[Stats::LOOKUP]) << std::endl
+        << "        replacer scan steps: " << diff.counters[Stats::SCAN] << " ("
+        << ratio(diff.counters[Stats::SCAN], diff.counters[Stats::VICTIM]) << " per victim)" << std::endl
+        << "        reads: " << diff.counters[Stats::READ_CALL] << " calls, " << diff.counters[Stats::READ_PAGE] << " pages, p50/p99 "
+        << latency(Stats::READ_LATENCY) << std::endl
+        << "        writes: " << diff.counters[Stats::WRITE_CALL] << " calls, " << diff.counters[Stats::WRITE_PAGE] << " pages, p50/p99 "
+        << latency(Stats::WRITE_LATENCY) << std::endl;
+}
+
+// 回放相关的命令行选项
+struct Options {
+    std::string algo_name;
+    Replacer::Algo algo;
+    int num_threads;
+    int num_frames;
+    bool use_aio;
+    AsyncIo::Engine aio_engine;
+    bool use_cleaner;
+    double cleaner_target;
+    int cleaner_depth;
+    int cleaner_rate;
+    int readahead;
+    int prefetch_ahead;
+    int pins;
+    int window;
+    bool checkpoint;
+    ReplacerParams params;
+    double load_duration;
+    bool use_static;
+    std::string stats_file_name; // 不为空时周期性地将统计快照写入该文件
+    bool stats_csv;
+    int stats_interval; // 毫秒
+    long long tier2_budget; // 压缩缓存的字节数, 0 为不使用
+};
+
+// 以 Manager 类型的缓冲区管理器回放 trace 并输出统计信息, Manager 为 BufferManager 或 BasicBufferManager<具体 replacer>
+template <typename Manager>
+static int run(DataStorageManager *dsmgr, const Trace &trace, const Options &options)
+{
+    // 后台写回线程与访问线程并发执行, 异步预取在完成线程中插入 replacer, 都需要并发模式
+    bool prefetch = options.readahead > 0 || options.prefetch_ahead > 0;
+    auto *bufmgr = new Manager {dsmgr, options.algo, options.num_frames, options.num_threads > 0 || options.use_cleaner || (options.use_aio && prefetch), options.params};
+    bufmgr->set_readahead(options.readahead);
+    AsyncIo *aio = nullptr;
+    if (options.use_aio) {
+        aio = new AsyncIo {dsmgr, options.aio_engine};
+        bufmgr->set_async_io(aio);
+    }
+    std::unique_ptr<CompressedCache> tier2;
+    if (options.tier2_budget > 0) {
+        tier2.reset(new CompressedCache {(size_t)options.tier2_budget, dsmgr->get_page_size()});
+        bufmgr->set_compressed_cache(tier2.get());
+    }
+    if (options.use_cleaner) {
+        bufmgr->start_cleaner(options.cleaner_target, options.cleaner_depth, options.cleaner_rate);
+    }
+    std::ofstream stats_out;
+    std::unique_ptr<StatsDumper> stats_dumper;
+    if (!options.stats_file_name.empty()) {
+        stats_out.open(options.stats_file_name);
+        Stats::set_timing(true);
+        stats_dumper.reset(new StatsDumper {stats_out, options.stats_csv, options.stats_interval});
+    }
+    Stats::Snapshot stats_before = Stats::snapshot();
+    int exhausted = 0;
+    auto before = std::chrono::high_resolution_clock::now();
+    if (options.num_threads > 0) {
+        exhausted = replay_concurrent(bufmgr, trace, options.num_threads, options.prefetch_ahead, options.pins, options.window);
+    } else if (options.window > 0) {
+        exhausted = replay_windows(bufmgr, trace, 0, 1, options.window);
+    } else {
+        exhausted = replay(bufmgr, trace, 0, 1, options.prefetch_ahead, options.pins);
+    }
+    auto after = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::duration<double>>(after - before).count();
+    bufmgr->stop_cleaner();
+    int checkpoint_pages = 0, checkpoint_io_before = dsmgr->io_count;
+    double checkpoint_duration = 0;
+    if (options.checkpoint) { // 不计入 io count
+        auto checkpoint_before = std::chrono::high_resolution_clock::now();
+        checkpoint_pages = bufmgr->checkpoint();
+        checkpoint_duration = std::chrono::duration_cast<std::chrono::duration<double>>(
+            std::chrono::high_resolution_clock::now() - checkpoint_before).count();
+    }
+    int checkpoint_io = dsmgr->io_count - checkpoint_io_before;
+    stats_dumper.reset();
+    Stats::Snapshot stats = Stats::snapshot();
+
+    int io_count = checkpoint_io_before, access_count = bufmgr->access_count, hit_count = bufmgr->hit_count;
+    double hit_rate = static_cast<double>(hit_count) / static_cast<double>(access_count);
+    std::cout << options.algo_name + ": " << std::endl
+        << "    access count: " << access_count << std::endl
+        << "    hit count: " << hit_count << std::endl
+        << "    hit rate: " << hit_rate << std::endl
+        << "    io count: " << io_count << std::endl
+        << "    time: " << duration << "s" << std::endl
+        << "    ns per access: " << duration / access_count * 1e9 << (options.use_static ? " (static)" : "") << std::endl
+        << "    trace load time: " << options.load_duration << "s" << (trace.is_binary() ? " (binary)" : "") << std::endl;
+    if (dsmgr->get_io_mode() != DataStorageManager::STDIO) {
+        const char *modes[] = {"stdio", "pread", "direct", "none"};
+        std::cout << "    io mode: " << modes[dsmgr->get_io_mode()] << std::endl;
+    }
+    if (dsmgr->get_num_files() > 1) {
+        std::cout << "    data files: " << dsmgr->get_num_files() << ", stripe: " << dsmgr->get_stripe_pages() << " pages" << std::endl;
+    }
+    if (options.num_threads > 0) {
+        std::cout << "    threads: " << options.num_threads << std::endl
+            << "    throughput: " << access_count / duration << " ops/s" << std::endl;
+    }
+    if (options.pins > 0) {
+        std::cout << "    pins: " << options.pins << std::endl
+            << "    pool exhausted count: " << exhausted << std::endl;
+    }
+    if (options.window > 0) {
+        std::cout << "    window: " << options.window << std::endl
+            << "    batch read count: " << bufmgr->batch_read_count << std::endl
+            << "    batch pages read: " << bufmgr->batch_page_count << std::endl
+            << "    pool exhausted count: " << exhausted << std::endl;
+    }
+    if (options.checkpoint) {
+        std::cout << "    checkpoint pages: " << checkpoint_pages << std::endl
+            << "    checkpoint writes: " << checkpoint_io << std::endl
+            << "    checkpoint time: " << checkpoint_duration << "s" << std::endl;
+    }
+    if (options.use_cleaner) {
+        std::cout << "    evict count: " << bufmgr->evict_count << std::endl
+            << "    dirty evict count: " << bufmgr->dirty_evict_count << std::endl
+            << "    cleaner writes: " << bufmgr->clean_count << std::endl;
+    }
+    if (prefetch) {
+        std::cout << "    prefetch count: " << bufmgr->prefetch_count << std::endl
+            << "    prefetch hit count: " << bufmgr->prefetch_hit_count << std::endl
+            << "    demand hit count: " << hit_count - bufmgr->prefetch_hit_count << std::endl
+            << "    prefetch unused count: " << bufmgr->prefetch_unused_count << std::endl;
+    }
+    if (tier2 != nullptr) {
+        int tier2_hits = bufmgr->tier2_hit_count, misses = access_count - hit_count;
+        std::cout << "    tier-2 hits: " << tier2_hits << " of " << misses << " misses ("
+            << (misses > 0 ? (double)tier2_hits / misses : 0) << ")" << std::endl
+            << "    io avoided: " << tier2_hits << std::endl;
+        tier2->print_stats(std::cout);
+    }
+    if (!options.stats_file_name.empty()) {
+        print_stats(stats_before, stats);
+    }
+    if (aio != nullptr) {
+        aio->print_stats(std::cout);
+    }
+    delete bufmgr;
+    delete aio;
+    return 0;
+}
+
+// 按 algo 选择静态分派的 BasicBufferManager, replacer 的调用在编译期确定并可以被内联
+static int run_static(DataStorageManager *dsmgr, const Trace &trace, const Options &options)
+{
+    switch (options.algo) {
+    case Replacer::LRU:
+        return run<BasicBufferManager<LruReplacer>>(dsmgr, trace, options);
+    case Replacer::MRU:
+        return run<BasicBufferManager<MruReplacer>>(dsmgr, trace, options);
+    case Replacer::RANDOM:
+        return run<BasicBufferManager<RandomReplacer>>(dsmgr, trace, options);
+    case Replacer::CLOCK:
+        return run<BasicBufferManager<ClockReplacer>>(dsmgr, trace, options);
+    case Replacer::LRU_2:
+        return run<BasicBufferManager<Lru2Replacer>>(dsmgr, trace, options);
+    case Replacer::TWO_QUEUE:
+        return run<BasicBufferManager<TwoQueueReplacer>>(dsmgr, trace, options);
+    case Replacer::LRU_K:
+        return run<BasicBufferManager<LruKReplacer>>(dsmgr, trace, options);
+    case Replacer::ARC:
+        return run<BasicBufferManager<ArcReplacer>>(dsmgr, trace, options);
+    case Replacer::CAR:
+        return run<BasicBufferManager<CarReplacer>>(dsmgr, trace, options);
+    case Replacer::CLOCK_PRO:
+        return run<BasicBufferManager<ClockProReplacer>>(dsmgr, trace, options);
+    }
+    return -1;
+}
+
+// adblab simulate: 不做真实 I/O, 对每个算法与缓冲区大小的组合各用一个线程回放 trace, 输出 CSV
+static int simulate(int argc, char **argv)
+{
+    bool parse_fail = false;
+    std::vector<std::string> algo_names = {"lru", "mru", "random", "clock", "lru-2", "2q", "lru-k", "arc", "car", "clock-pro"};
+    std::vector<int> pool_sizes = {128, 256, 512, 1024, 2048, 4096, 8192};
+    int jobs = std::max(1, (int)std::thread::hardware_concurrency());
+    ReplacerParams params;
+    std::string trace_file_name = "data/data-5w-50w-zipf.txt";
+    std::string output_file_name; // 为空时输出到标准输出
+    for (int i = 2; i < argc && !parse_fail; i++) {
+        std::string option = argv[i];
+        if (option == "--algos" && i + 1 < argc) {
+            algo_names = split_list(argv[++i]);
+        } else if (option == "--pool-sizes" && i + 1 < argc) {
+            pool_sizes.clear();
+            for (const std::string &item : split_list(argv[++i])) {
+                pool_sizes.push_back(atoi(item.c_str()));
+                parse_fail = parse_fail || pool_sizes.back() <= 0;
+            }
+        } else if (option == "--jobs" && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+            parse_fail = jobs <= 0;
+        } else if (option == "--k" && i + 1 < argc) {
+            params.k = atoi(argv[++i]);
+            parse_fail = params.k <= 0;
+        } else if (option == "--kin" && i + 1 < argc) {
+            params.kin = atof(argv[++i]);
+            parse_fail = params.kin < 0;
+        } else if (option == "--kout" && i + 1 < argc) {
+            params.kout = atof(argv[++i]);
+            parse_fail = params.kout < 0;
+        } else if (option == "--trace" && i + 1 < argc) {
+            trace_file_name = argv[++i];
+        } else if (option == "--output" && i + 1 < argc) {
+            output_file_name = argv[++i];
+        } else {
+            parse_fail = true;
+        }
+    }
+    std::vector<Replacer::Algo> algos(algo_names.size());
+    for (size_t i = 0; i < algo_names.size() && !parse_fail; i++) {
+        parse_fail = !parse_algo(algo_names[i], algos[i]);
+    }
+    if (parse_fail) {
+        std::cout << "error: wrong format, please use" << std::endl;
+        std::cout << "    adblab simulate [--algos ALGO,...] [--pool-sizes FRAMES,...] [--jobs N]" << std::endl;
+        std::cout << "        [--k K] [--kin RATIO] [--kout RATIO] [--trace FILE] [--output CSV_FILE]" << std::endl;
+        return -1;
+    }
+    Trace trace;
+    if (trace.load(trace_file_name) < 0) {
+        std::cout << "error: cannot load trace " << trace_file_name << std::endl;
+        return -1;
+    }
+    Simulator simulator {trace, params};
+    for (size_t i = 0; i < algos.size(); i++) {
+        for (int num_frames : pool_sizes) {
+            simulator.add(algo_names[i], algos[i], num_frames);
+        }
+    }
+    simulator.run(jobs);
+    if (output_file_name.empty()) {
+        simulator.write_csv(std::cout);
+        return 0;
+    }
+    std::ofstream out {output_file_name};
+    simulator.write_csv(out);
+    if (!out) {
+        std::cout << "error: cannot write " << output_file_name << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     bool parse_fail = false;
     std::string algo_name;
     Replacer::Algo algo;
-    if (argc == 2) {
+    int num_threads = 0; // 0 表示单线程
+    int num_frames = DEFBUFSIZE;
+    int page_size = PAGESIZE;
+    int max_pages = MAXPAGES;
+    long long pool_memory = 0; // 不为 0 时由内存大小计算 frame 数量
+    DataStorageManager::IoMode io_mode = DataStorageManager::STDIO;
+    std::vector<std::string> db_names = {"data/data.dbf"}; // 表空间的数据文件, page 按条带分布在其中
+    int stripe_pages = STRIPEPAGES;
+    bool use_aio = false;
+    AsyncIo::Engine aio_engine = AsyncIo::IO_URING;
+    bool use_cleaner = false;
+    double cleaner_target = 0.1;
+    int cleaner_depth = 256;
+    int cleaner_rate = 0;
+    int readahead = 0;
+    int prefetch_ahead = 0; // 按 trace 预取的提前量, 0 为不预取
+    int pins = 0; // 回放时保持 pin 住的最近访问的 page 数
+    int window = 0; // 不为 0 时以 fix_pages 每批回放 window 个访问
+    bool checkpoint = false; // 回放结束后做一次 checkpoint 并计时
+    ReplacerParams params;
+    bool sweep = false;
+    bool use_static = false; // 使用静态分派 replacer 的 BasicBufferManager
+    std::string stats_file_name;
+    bool stats_csv = false;
+    int stats_interval = 1000;
+    long long tier2_budget = 0;
+    std::string trace_file_name = "data/data-5w-50w-zipf.txt";
+    std::string convert_file_name; // 不为空时将 trace 转换为二进制格式写入该文件后退出
+    if (argc >= 2 && std::string(argv[1]) == "simulate") {
+        return simulate(argc, argv);
+    }
+    if (argc >= 2) {
         algo_name = argv[1];
-        if (algo_name == "lru") {
-            algo = Replacer::LRU;
-        } else if (algo_name == "mru") {
-            algo = Replacer::MRU;
-        } else if (algo_name == "random") {
-            algo = Replacer::RANDOM;
-        } else if (algo_name == "clock") {
-            algo = Replacer::CLOCK;
-        } else if (algo_name == "lru-2") {
-            algo = Replacer::LRU_2;
-        } else if (algo_name == "2q") {
-            algo = Replacer::TWO_QUEUE;
+        parse_fail = !parse_algo(algo_name, algo);
+    } else {
+        parse_fail = true;
+    }
+    for (int i = 2; i < argc && !parse_fail; i++) {
+        std::string option = argv[i];
+        if (option == "--threads" && i + 1 < argc) {
+            num_threads = atoi(argv[++i]);
+            parse_fail = num_threads <= 0;
+        } else if (option == "--pool-size" && i + 1 < argc) {
+            num_frames = atoi(argv[++i]);
+            parse_fail = num_frames <= 0;
+        } else if (option == "--pool-memory" && i + 1 < argc) {
+            parse_fail = !parse_size(argv[++i], pool_memory);
+        } else if (option == "--page-size" && i + 1 < argc) {
+            page_size = atoi(argv[++i]);
+            parse_fail = page_size <= 0;
+        } else if (option == "--max-pages" && i + 1 < argc) {
+            max_pages = atoi(argv[++i]);
+            parse_fail = max_pages <= 0;
+        } else if (option == "--io" && i + 1 < argc) {
+            parse_fail = !parse_io_mode(argv[++i], io_mode);
+        } else if (option == "--data-files" && i + 1 < argc) {
+            db_names = split_list(argv[++i]);
+            for (const std::string &name : db_names) {
+                parse_fail = parse_fail || name.empty();
+            }
+        } else if (option == "--stripe" && i + 1 < argc) {
+            stripe_pages = atoi(argv[++i]);
+            parse_fail = stripe_pages <= 0;
+        } else if (option == "--aio" && i + 1 < argc) {
+            std::string engine = argv[++i];
+            use_aio = true;
+            aio_engine = engine == "threads" ? AsyncIo::THREAD_POOL : AsyncIo::IO_URING;
+            parse_fail = engine != "threads" && engine != "uring";
+        } else if (option == "--cleaner") {
+            use_cleaner = true;
+        } else if (option == "--cleaner-target" && i + 1 < argc) {
+            use_cleaner = true;
+            cleaner_target = atof(argv[++i]);
+            parse_fail = cleaner_target < 0 || cleaner_target > 1;
+        } else if (option == "--cleaner-depth" && i + 1 < argc) {
+            use_cleaner = true;
+            cleaner_depth = atoi(argv[++i]);
+            parse_fail = cleaner_depth <= 0;
+        } else if (option == "--cleaner-rate" && i + 1 < argc) {
+            use_cleaner = true;
+            cleaner_rate = atoi(argv[++i]);
+            parse_fail = cleaner_rate < 0;
+        } else if (option == "--readahead" && i + 1 < argc) {
+            readahead = atoi(argv[++i]);
+            parse_fail = readahead < 0;
+        } else if (option == "--prefetch-ahead" && i + 1 < argc) {
+            prefetch_ahead = atoi(argv[++i]);
+            parse_fail = prefetch_ahead < 0;
+        } else if (option == "--k" && i + 1 < argc) {
+            params.k = atoi(argv[++i]);
+            parse_fail = params.k <= 0;
+        } else if (option == "--crp" && i + 1 < argc) {
+            params.correlated_period = atoi(argv[++i]);
+            parse_fail = params.correlated_period < 0;
+        } else if (option == "--history" && i + 1 < argc) {
+            params.retained_history = atoi(argv[++i]);
+            parse_fail = params.retained_history < 0;
+        } else if (option == "--kin" && i + 1 < argc) {
+            params.kin = atof(argv[++i]);
+            parse_fail = params.kin < 0;
+        } else if (option == "--kout" && i + 1 < argc) {
+            params.kout = atof(argv[++i]);
+            parse_fail = params.kout < 0;
+        } else if (option == "--pins" && i + 1 < argc) {
+            pins = atoi(argv[++i]);
+            parse_fail = pins < 0;
+        } else if (option == "--window" && i + 1 < argc) {
+            window = atoi(argv[++i]);
+            parse_fail = window <= 0;
+        } else if (option == "--checkpoint") {
+            checkpoint = true;
+        } else if (option == "--trace" && i + 1 < argc) {
+            trace_file_name = argv[++i];
+        } else if (option == "--convert" && i + 1 < argc) {
+            convert_file_name = argv[++i];
+        } else if (option == "--stats" && i + 1 < argc) {
+            stats_file_name = argv[++i];
+            parse_fail = !Stats::enabled();
+        } else if (option == "--stats-format" && i + 1 < argc) {
+            std::string format = argv[++i];
+            stats_csv = format == "csv";
+            parse_fail = format != "csv" && format != "json";
+        } else if (option == "--stats-interval" && i + 1 < argc) {
+            stats_interval = atoi(argv[++i]);
+            parse_fail = stats_interval <= 0;
+        } else if (option == "--tier2" && i + 1 < argc) {
+            parse_fail = !parse_size(argv[++i], tier2_budget) || tier2_budget <= 0;
+        } else if (option == "--static") {
+            use_static = true;
+        } else if (option == "--sweep") {
+            sweep = true;
+            parse_fail = algo != Replacer::TWO_QUEUE;
         } else {
             parse_fail = true;
         }
-    } else {
+    }
+    if (window > 0 && (pins > 0 || prefetch_ahead > 0)) {
         parse_fail = true;
     }
+    if (pool_memory > 0) {
+        num_frames = (int)std::min<long long>(pool_memory / page_size, 0x7fffffff);
+        parse_fail = parse_fail || num_frames <= 0;
+    }
     if (parse_fail) {
         std::cout << "error: wrong format, please use" << std::endl;
-        std::cout << "    adblab [lru|mru|random|clock|lru-2|2q]" << std::endl;
+        std::cout << "    adblab [lru|mru|random|clock|lru-2|2q|lru-k|arc|car|clock-pro] [--threads N]" << std::endl;
+        std::cout << "        [--pool-size FRAMES | --pool-memory BYTES[K|M|G]|PERCENT%]" << std::endl;
+        std::cout << "        [--page-size BYTES] [--max-pages PAGES] [--io stdio|pread|direct|none] [--aio uring|threads]" << std::endl;
+        std::cout << "        [--data-files FILE,...] [--stripe PAGES]" << std::endl;
+        std::cout << "        [--cleaner] [--cleaner-target RATIO] [--cleaner-depth FRAMES] [--cleaner-rate PAGES_PER_SEC]" << std::endl;
+        std::cout << "        [--readahead PAGES] [--prefetch-ahead ACCESSES] [--pins PAGES] [--window ACCESSES] [--checkpoint]" << std::endl;
+        std::cout << "        [--k K] [--crp ACCESSES] [--history PAGES] [--kin RATIO] [--kout RATIO] [--sweep]" << std::endl;
+        std::cout << "        [--trace FILE] [--convert BINARY_FILE] [--static] [--tier2 BYTES[K|M|G]]" << std::endl;
+        std::cout << "        [--stats FILE] [--stats-format json|csv] [--stats-interval MS]"
+            << (Stats::enabled() ? "" : " (stats disabled in this build)") << std::endl;
+        std::cout << "    adblab simulate [--algos ALGO,...] [--pool-sizes FRAMES,...] [--jobs N] [--output CSV_FILE]" << std::endl;
+        return -1;
+    }
+    // trace 在计时之前全部载入, 计时只包含 fix_page/unfix_page
+    Trace trace;
+    auto load_before = std::chrono::high_resolution_clock::now();
+    if (trace.load(trace_file_name) < 0) {
+        std::cout << "error: cannot load trace " << trace_file_name << std::endl;
+        return -1;
+    }
+    auto load_duration = std::chrono::duration_cast<std::chrono::duration<double>>(
+        std::chrono::high_resolution_clock::now() - load_before).count();
+    if (!convert_file_name.empty()) {
+        if (trace.save_binary(convert_file_name) < 0) {
+            std::cout << "error: cannot write " << convert_file_name << std::endl;
+            return -1;
+        }
+        std::cout << "converted " << trace.size() << " accesses to " << convert_file_name << std::endl;
+        return 0;
+    }
+    auto *dsmgr = new DataStorageManager {page_size, max_pages};
+    dsmgr->set_stripe_pages(stripe_pages);
+    if (!dsmgr->open_files(db_names, io_mode)) {
+        std::cout << "error: cannot open data files (a non-empty file without a recognized header, or a tablespace"
+            << " created with a different number of files)" << std::endl;
+        delete dsmgr;
         return -1;
     }
-    std::string db_name = "data/data.dbf";
-    std::string trace_file_name = "data/data-5w-50w-zipf.txt";
-    FILE *trace_file = fopen(trace_file_name.c_str(), "r");
-    auto *dsmgr = new DataStorageManager;
-    dsmgr->open_file(db_name);
     while (dsmgr->get_num_pages() < NUM_PAGES) {
         // 没有使用 FixNewPage 进行构造, 因为按照 pdf 理解 FixNewPage 将影响 buffer_manager, 而此处目的仅仅为了获得一个初始的数据库
-        dsmgr->set_use(dsmgr->get_num_pages(), 1);
-        dsmgr->inc_num_pages();
+        if (dsmgr->inc_num_pages() < 0) {
+            std::cout << "error: max pages " << max_pages << " is less than " << NUM_PAGES << std::endl;
+            return -1;
+        }
     }
     dsmgr->io_count = 0;
-    auto *bufmgr = new BufferManager {dsmgr, algo};
-    int read_or_write, page_id;
-
-    auto before = std::chrono::high_resolution_clock::now();
-    while (fscanf(trace_file, "%d,%d", &read_or_write, &page_id) == 2) {
-        bufmgr->fix_page(page_id, read_or_write);
-        bufmgr->unfix_page(page_id);
-        // std::cout << "access count: " << bufmgr->access_count << std::endl;
+    if (sweep) {
+        sweep_2q(dsmgr, trace, num_frames, params);
+        dsmgr->close_file();
+        delete dsmgr;
+        return 0;
     }
-    auto after = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::duration<double>>(after - before).count();
-
-    int io_count = dsmgr->io_count, access_count = bufmgr->access_count, hit_count = bufmgr->hit_count;
-    double hit_rate = static_cast<double>(hit_count) / static_cast<double>(access_count);
-    std::cout << algo_name + ": " << std::endl
-        << "    access count: " << access_count << std::endl
-        << "    hit count: " << hit_count << std::endl
-        << "    hit rate: " << hit_rate << std::endl
-        << "    io count: " << io_count << std::endl
-        << "    time: " << duration << "s" << std::endl;
-    delete bufmgr;
+    Options options {algo_name, algo, num_threads, num_frames, use_aio, aio_engine, use_cleaner, cleaner_target,
+        cleaner_depth, cleaner_rate, readahead, prefetch_ahead, pins, window, checkpoint, params, load_duration, use_static,
+        stats_file_name, stats_csv, stats_interval, tier2_budget};
+    int ret = use_static ? run_static(dsmgr, trace, options) : run<BufferManager>(dsmgr, trace, options);
     dsmgr->close_file();
     delete dsmgr;
-    return 0;
-}
\ No newline at end of file
+    return ret;
+}
@@ -0,0 +1,44 @@
+#include "options.h"
+
+std::vector<std::string> split_list(const std::string &text)
+{
+    std::vector<std::string> items;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        items.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+    return items;
+}
+
+bool parse_algo(const std::string &algo_name, Replacer::Algo &algo)
+{
+    if (algo_name == "lru") {
+        algo = Replacer::LRU;
+    } else if (algo_name == "mru") {
+        algo = Replacer::MRU;
+    } else if (algo_name == "random") {
+        algo = Replacer::RANDOM;
+    } else if (algo_name == "clock") {
+        algo = Replacer::CLOCK;
+    } else if (algo_name == "lru-2") {
+        algo = Replacer::LRU_2;
+    } else if (algo_name == "2q") {
+        algo = Replacer::TWO_QUEUE;
+    } else if (algo_name == "lru-k") {
+        algo = Replacer::LRU_K;
+    } else if (algo_name == "arc") {
+        algo = Replacer::ARC;
+    } else if (algo_name == "car") {
+        algo = Replacer::CAR;
+    } else if (algo_name == "clock-pro") {
+        algo = Replacer::CLOCK_PRO;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,92 @@
+#include "page_table.h"
+#include "stats.h"
+
+PageTable::PageTable(int capacity): m_size(0)
+{
+    uint32_t n = 16;
+    while (n < (uint32_t)capacity) {
+        n <<= 1;
+    }
+    m_mask = n - 1;
+    m_slots = new Slot[n];
+    for (uint32_t i = 0; i < n; i++) {
+        m_slots[i].page_id = -1;
+    }
+}
+
+PageTable::~PageTable()
+{
+    delete[] m_slots;
+}
+
+int PageTable::find(int page_id) const
+{
+    STATS_INC(LOOKUP);
+    for (uint32_t i = hash(page_id) & m_mask, probes = 1; ; i = (i + 1) & m_mask, probes++) {
+        if (m_slots[i].page_id == page_id) {
+            STATS_ADD(PROBE, probes);
+            return m_slots[i].frame_id;
+        }
+        if (m_slots[i].page_id == -1) {
+            STATS_ADD(PROBE, probes);
+            return -1;
+        }
+    }
+}
+
+void PageTable::insert(int page_id, int frame_id)
+{
+    if ((uint32_t)(m_size + 1) * 2 > m_mask + 1) {
+        grow();
+    }
+    uint32_t i = hash(page_id) & m_mask;
+    while (m_slots[i].page_id != -1 && m_slots[i].page_id != page_id) {
+        i = (i + 1) & m_mask;
+    }
+    if (m_slots[i].page_id == -1) {
+        m_size++;
+    }
+    m_slots[i] = {page_id, frame_id};
+}
+
+bool PageTable::remove(int page_id)
+{
+    uint32_t i = hash(page_id) & m_mask;
+    while (m_slots[i].page_id != page_id) {
+        if (m_slots[i].page_id == -1) {
+            return false;
+        }
+        i = (i + 1) & m_mask;
+    }
+    // backward shift: 将探测序列上后续的元素前移, 填补空出的槽位
+    uint32_t hole = i;
+    for (uint32_t j = (i + 1) & m_mask; m_slots[j].page_id != -1; j = (j + 1) & m_mask) {
+        uint32_t home = hash(m_slots[j].page_id) & m_mask;
+        // home 不在 (hole, j] 之间时, 元素 j 可以移动到 hole
+        if (((j - home) & m_mask) >= ((j - hole) & m_mask)) {
+            m_slots[hole] = m_slots[j];
+            hole = j;
+        }
+    }
+    m_slots[hole].page_id = -1;
+    m_size--;
+    return true;
+}
+
+void PageTable::grow()
+{
+    Slot *old_slots = m_slots;
+    uint32_t old_capacity = m_mask + 1;
+    m_mask = old_capacity * 2 - 1;
+    m_slots = new Slot[old_capacity * 2];
+    for (uint32_t i = 0; i <= m_mask; i++) {
+        m_slots[i].page_id = -1;
+    }
+    m_size = 0;
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        if (old_slots[i].page_id != -1) {
+            insert(old_slots[i].page_id, old_slots[i].frame_id);
+        }
+    }
+    delete[] old_slots;
+}
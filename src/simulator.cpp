@@ -0,0 +1,71 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include "simulator.h"
+
+Simulator::Simulator(const Trace &trace, const ReplacerParams &params): m_trace(trace), m_params(params), m_num_pages(0)
+{
+    for (size_t i = 0; i < trace.size(); i++) {
+        m_num_pages = std::max(m_num_pages, trace.page_id(i) + 1);
+    }
+}
+
+void Simulator::add(const std::string &algo_name, Replacer::Algo algo, int num_frames)
+{
+    m_configs.push_back({algo_name, algo, num_frames, 0, 0, 0, 0});
+}
+
+// 工作线程按顺序取出尚未模拟的组合, 组合之间不共享任何状态
+void Simulator::run(int jobs)
+{
+    std::atomic<size_t> next {0};
+    std::vector<std::thread> workers;
+    int num_workers = std::max(1, std::min(jobs, (int)m_configs.size()));
+    for (int t = 0; t < num_workers; t++) {
+        workers.emplace_back([this, &next]() {
+            for (size_t i = next++; i < m_configs.size(); i = next++) {
+                simulate(m_configs[i]);
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void Simulator::simulate(Config &config) const
+{
+    auto *dsmgr = new DataStorageManager {SIMPAGESIZE, std::max(m_num_pages, 1)};
+    dsmgr->open_file("", DataStorageManager::NONE);
+    while (dsmgr->get_num_pages() < m_num_pages) {
+        dsmgr->inc_num_pages();
+    }
+    dsmgr->io_count = 0;
+    auto *bufmgr = new BufferManager {dsmgr, config.algo, config.num_frames, false, m_params};
+    auto before = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < m_trace.size(); i++) {
+        if (bufmgr->fix_page(m_trace.page_id(i), m_trace.write(i)) >= 0) {
+            bufmgr->unfix_page(m_trace.page_id(i));
+        }
+    }
+    auto after = std::chrono::high_resolution_clock::now();
+    config.seconds = std::chrono::duration_cast<std::chrono::duration<double>>(after - before).count();
+    config.hits = bufmgr->hit_count;
+    config.writes = bufmgr->dirty_evict_count;
+    config.reads = dsmgr->io_count - config.writes;
+    delete bufmgr;
+    dsmgr->close_file();
+    delete dsmgr;
+}
+
+void Simulator::write_csv(std::ostream &out) const
+{
+    out << "algo,pool size,access count,hit count,hit rate,miss ratio,reads,writes,io count,time" << std::endl;
+    for (const Config &config : m_configs) {
+        double accesses = std::max<double>((double)m_trace.size(), 1);
+        out << config.algo_name << "," << config.num_frames << "," << m_trace.size() << "," << config.hits << ","
+            << config.hits / accesses << "," << 1 - config.hits / accesses << ","
+            << config.reads << "," << config.writes << "," << config.reads + config.writes << "," << config.seconds << std::endl;
+    }
+}
@@ -0,0 +1,13 @@
+#include "buffer_impl.h"
+#include "replacers.h"
+
+template class BasicBufferManager<LruReplacer>;
+template class BasicBufferManager<MruReplacer>;
+template class BasicBufferManager<RandomReplacer>;
+template class BasicBufferManager<ClockReplacer>;
+template class BasicBufferManager<ClockProReplacer>;
+template class BasicBufferManager<Lru2Replacer>;
+template class BasicBufferManager<TwoQueueReplacer>;
+template class BasicBufferManager<LruKReplacer>;
+template class BasicBufferManager<ArcReplacer>;
+template class BasicBufferManager<CarReplacer>;
@@ -0,0 +1,153 @@
+#include <mutex>
+#include "stats.h"
+
+static const char *counter_names[Stats::NUM_COUNTERS] = {
+    "fix", "hit", "miss", "evict", "dirty_evict", "lookup", "probe", "victim", "scan",
+    "read_call", "read_page", "write_call", "write_page"
+};
+
+static const char *histogram_names[Stats::NUM_HISTOGRAMS] = {"fix", "miss", "read", "write"};
+
+static std::mutex stats_latch; // 保护新线程加入链表
+static std::atomic<Stats::ThreadStats *> stats_head {nullptr};
+static const long long stats_start = Stats::now();
+std::atomic<bool> Stats::s_timing {false};
+
+// 新线程的统计加在链表头, 之后不再删除, snapshot 不需要加锁即可遍历
+Stats::ThreadStats *Stats::enroll()
+{
+    ThreadStats *stats = new ThreadStats;
+    for (auto &counter : stats->counters) {
+        counter = 0;
+    }
+    for (auto &histogram : stats->histograms) {
+        for (auto &bucket : histogram) {
+            bucket = 0;
+        }
+    }
+    std::lock_guard<std::mutex> latch {stats_latch};
+    stats->next = stats_head.load(std::memory_order_relaxed);
+    stats_head.store(stats, std::memory_order_release);
+    return stats;
+}
+
+Stats::Snapshot Stats::snapshot()
+{
+    Snapshot snapshot {};
+    for (ThreadStats *stats = stats_head.load(std::memory_order_acquire); stats != nullptr; stats = stats->next) {
+        for (int i = 0; i < NUM_COUNTERS; i++) {
+            snapshot.counters[i] += stats->counters[i].load(std::memory_order_relaxed);
+        }
+        for (int h = 0; h < NUM_HISTOGRAMS; h++) {
+            for (int b = 0; b < STATSBUCKETS; b++) {
+                snapshot.histograms[h][b] += stats->histograms[h][b].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    snapshot.seconds = (now() - stats_start) / 1e9;
+    return snapshot;
+}
+
+long long Stats::Snapshot::count(Histogram histogram) const
+{
+    long long total = 0;
+    for (int b = 0; b < STATSBUCKETS; b++) {
+        total += histograms[histogram][b];
+    }
+    return total;
+}
+
+long long Stats::Snapshot::percentile(Histogram histogram, double p) const
+{
+    long long total = count(histogram), seen = 0;
+    if (total == 0) {
+        return 0;
+    }
+    for (int b = 0; b < STATSBUCKETS; b++) {
+        seen += histograms[histogram][b];
+        if (seen >= p * total) {
+            return b == 0 ? 0 : 1LL << b;
+        }
+    }
+    return 1LL << (STATSBUCKETS - 1);
+}
+
+void Stats::Snapshot::write_json(std::ostream &out) const
+{
+    out << "{\"time\":" << seconds;
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        out << ",\"" << counter_names[i] << "\":" << counters[i];
+    }
+    for (int h = 0; h < NUM_HISTOGRAMS; h++) {
+        out << ",\"" << histogram_names[h] << "_latency\":{\"count\":" << count((Histogram)h)
+            << ",\"p50\":" << percentile((Histogram)h, 0.5) << ",\"p99\":" << percentile((Histogram)h, 0.99)
+            << ",\"buckets\":[";
+        for (int b = 0; b < STATSBUCKETS; b++) {
+            out << (b > 0 ? "," : "") << histograms[h][b];
+        }
+        out << "]}";
+    }
+    out << "}" << std::endl;
+}
+
+void Stats::Snapshot::write_csv_header(std::ostream &out)
+{
+    out << "time";
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        out << "," << counter_names[i];
+    }
+    for (int h = 0; h < NUM_HISTOGRAMS; h++) {
+        out << "," << histogram_names[h] << "_count," << histogram_names[h] << "_p50," << histogram_names[h] << "_p99";
+    }
+    out << std::endl;
+}
+
+void Stats::Snapshot::write_csv(std::ostream &out) const
+{
+    out << seconds;
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        out << "," << counters[i];
+    }
+    for (int h = 0; h < NUM_HISTOGRAMS; h++) {
+        out << "," << count((Histogram)h) << "," << percentile((Histogram)h, 0.5) << "," << percentile((Histogram)h, 0.99);
+    }
+    out << std::endl;
+}
+
+StatsDumper::StatsDumper(std::ostream &out, bool csv, int interval_ms): m_out(out), m_csv(csv), m_interval_ms(interval_ms), m_stop(false)
+{
+    if (m_csv) {
+        Stats::Snapshot::write_csv_header(m_out);
+    }
+    dump();
+    m_thread = std::thread {&StatsDumper::work, this};
+}
+
+StatsDumper::~StatsDumper()
+{
+    {
+        std::lock_guard<std::mutex> latch {m_latch};
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    m_thread.join();
+    dump();
+}
+
+void StatsDumper::dump()
+{
+    Stats::Snapshot snapshot = Stats::snapshot();
+    if (m_csv) {
+        snapshot.write_csv(m_out);
+    } else {
+        snapshot.write_json(m_out);
+    }
+}
+
+void StatsDumper::work()
+{
+    std::unique_lock<std::mutex> latch {m_latch};
+    while (!m_cond.wait_for(latch, std::chrono::milliseconds(m_interval_ms), [this]() { return m_stop; })) {
+        dump();
+    }
+}
@@ -0,0 +1,161 @@
+#include "trace.h"
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+Trace::Trace(): m_page_ids(nullptr), m_writes(nullptr), m_size(0), m_map(nullptr), m_map_length(0)
+{
+}
+
+Trace::~Trace()
+{
+    clear();
+}
+
+void Trace::clear()
+{
+    if (m_map != nullptr) {
+        munmap(m_map, m_map_length);
+        m_map = nullptr;
+        m_map_length = 0;
+    }
+    m_page_id_buffer.clear();
+    m_write_buffer.clear();
+    m_page_ids = nullptr;
+    m_writes = nullptr;
+    m_size = 0;
+}
+
+int Trace::load(const std::string &filename)
+{
+    clear();
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+    size_t length = (size_t)st.st_size;
+    if (length == 0) {
+        close(fd);
+        return 0;
+    }
+    // 先只读出文件头判断格式, 二进制格式需要 MAP_POPULATE 预先读入整个文件
+    char magic[sizeof(Header::magic)] = {};
+    bool binary = pread(fd, magic, sizeof(magic), 0) == (ssize_t)sizeof(magic)
+        && memcmp(magic, TRACEMAGIC, sizeof(magic)) == 0;
+    void *map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE | (binary ? MAP_POPULATE : 0), fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    if (binary) {
+        return map_binary(map, length);
+    }
+    madvise(map, length, MADV_SEQUENTIAL);
+    int ret = parse_text((const char *)map, length);
+    munmap(map, length);
+    return ret;
+}
+
+int Trace::map_binary(void *map, size_t length)
+{
+    Header header;
+    if (length >= sizeof(header)) {
+        memcpy(&header, map, sizeof(header));
+    }
+    // 每个访问占 4 字节 page_id 与 1 字节读写标志
+    if (length < sizeof(header) || header.count > length || sizeof(header) + header.count * 5 != length) {
+        munmap(map, length);
+        return -1;
+    }
+    m_map = map;
+    m_map_length = length;
+    m_size = header.count;
+    m_page_ids = (const int32_t *)((const char *)map + sizeof(header));
+    m_writes = (const uint8_t *)(m_page_ids + m_size);
+    return 0;
+}
+
+// 解析 "write,page_id" 行. 先用 memchr 数出行数以一次分配好数组, 再逐字节累加十进制数字;
+// 行尾的 '\r' 与空行被跳过, 格式不正确时返回 -1
+int Trace::parse_text(const char *data, size_t length)
+{
+    size_t lines = 0;
+    for (const char *p = data, *end = data + length; (p = (const char *)memchr(p, '\n', end - p)) != nullptr; p++) {
+        lines++;
+    }
+    m_page_id_buffer.resize(lines + 1);
+    m_write_buffer.resize(lines + 1);
+    int32_t *page_ids = m_page_id_buffer.data();
+    uint8_t *writes = m_write_buffer.data();
+    size_t n = 0;
+    const char *p = data, *end = data + length;
+    while (p < end) {
+        if (*p == '\n' || *p == '\r') {
+            p++;
+            continue;
+        }
+        unsigned write = 0;
+        const char *digits = p;
+        while (p < end && (unsigned)(*p - '0') < 10) {
+            write = write * 10 + (*p++ - '0');
+        }
+        if (p == digits || p == end || *p != ',') {
+            clear();
+            return -1;
+        }
+        p++;
+        uint32_t page_id = 0;
+        digits = p;
+        while (p < end && (unsigned)(*p - '0') < 10) {
+            page_id = page_id * 10 + (*p++ - '0');
+        }
+        if (p == digits || (p < end && *p != '\n' && *p != '\r')) {
+            clear();
+            return -1;
+        }
+        page_ids[n] = (int32_t)page_id;
+        writes[n] = write != 0;
+        n++;
+    }
+    m_page_id_buffer.resize(n);
+    m_write_buffer.resize(n);
+    m_page_ids = m_page_id_buffer.data();
+    m_writes = m_write_buffer.data();
+    m_size = n;
+    return 0;
+}
+
+void Trace::assign(std::vector<int32_t> page_ids, std::vector<uint8_t> writes)
+{
+    clear();
+    m_page_id_buffer = std::move(page_ids);
+    m_write_buffer = std::move(writes);
+    m_page_ids = m_page_id_buffer.data();
+    m_writes = m_write_buffer.data();
+    m_size = m_page_id_buffer.size();
+}
+
+int Trace::save_binary(const std::string &filename) const
+{
+    FILE *file = fopen(filename.c_str(), "wb");
+    if (file == nullptr) {
+        return -1;
+    }
+    Header header;
+    memcpy(header.magic, TRACEMAGIC, sizeof(header.magic));
+    header.count = m_size;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(m_page_ids, sizeof(int32_t), m_size, file) == m_size
+        && fwrite(m_writes, sizeof(uint8_t), m_size, file) == m_size;
+    ok = fclose(file) == 0 && ok;
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,107 @@
+#include <cmath>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include "workload.h"
+
+static const char *kind_names[Workload::NUM_KINDS] = {"zipf", "uniform", "scan", "scan-hot", "shifting"};
+
+bool Workload::parse(const std::string &name, Kind &kind)
+{
+    for (int i = 0; i < NUM_KINDS; i++) {
+        if (name == kind_names[i]) {
+            kind = (Kind)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *Workload::name(Kind kind)
+{
+    return kind_names[kind];
+}
+
+// 按预先计算的累积分布函数二分查找, 返回热度排名 [0, n)
+class ZipfSampler {
+public:
+    ZipfSampler(int n, double skew): m_cdf(n) {
+        double sum = 0;
+        for (int i = 0; i < n; i++) {
+            sum += 1.0 / std::pow(i + 1, skew);
+            m_cdf[i] = sum;
+        }
+        for (double &value : m_cdf) {
+            value /= sum;
+        }
+    }
+    int operator()(std::mt19937 &gen) {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(gen);
+        int rank = (int)(std::lower_bound(m_cdf.begin(), m_cdf.end(), u) - m_cdf.begin());
+        return std::min(rank, (int)m_cdf.size() - 1);
+    }
+private:
+    std::vector<double> m_cdf;
+};
+
+void Workload::generate(Kind kind, const WorkloadParams &params, Trace &trace, std::vector<uint8_t> *scans)
+{
+    int n = std::max(params.num_pages, 1);
+    std::mt19937 gen(params.seed);
+    std::vector<int32_t> page_ids(params.num_accesses);
+    std::vector<uint8_t> writes(params.num_accesses);
+    // 热度排名到 page_id 的随机排列
+    std::vector<int> order(n);
+    for (int i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), gen);
+    ZipfSampler zipf {kind == UNIFORM || kind == SCAN ? 1 : n, params.skew};
+    std::uniform_int_distribution<int> uniform(0, n - 1);
+    std::bernoulli_distribution write(params.write_ratio);
+    int scan_next = 0; // SCAN 与 SCAN_HOT 下一个扫描的 page
+    int scan_left = 0; // SCAN_HOT 当前扫描剩余的 page 数
+    int shift = 0;
+    if (scans != nullptr) {
+        scans->assign(params.num_accesses, kind == SCAN);
+    }
+    for (size_t i = 0; i < params.num_accesses; i++) {
+        int page_id;
+        switch (kind) {
+        case ZIPF:
+            page_id = order[zipf(gen)];
+            break;
+        case UNIFORM:
+            page_id = uniform(gen);
+            break;
+        case SCAN:
+            page_id = scan_next;
+            scan_next = (scan_next + 1) % n;
+            break;
+        case SCAN_HOT:
+            if (params.scan_interval > 0 && i > 0 && i % params.scan_interval == 0) {
+                scan_left = n;
+                scan_next = 0;
+            }
+            if (scan_left > 0) {
+                page_id = scan_next++;
+                scan_left--;
+                if (scans != nullptr) {
+                    (*scans)[i] = 1;
+                }
+            } else {
+                page_id = order[zipf(gen)];
+            }
+            break;
+        default: // SHIFTING
+            if (params.shift_interval > 0 && i > 0 && i % params.shift_interval == 0) {
+                shift = (shift + std::max(n / 10, 1)) % n;
+            }
+            page_id = (order[zipf(gen)] + shift) % n;
+            break;
+        }
+        page_ids[i] = page_id;
+        writes[i] = write(gen);
+    }
+    trace.assign(std::move(page_ids), std::move(writes));
+}
@@ -0,0 +1,47 @@
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include "buffer.h"
+
+/**
+ * 后台写回的限速: 所有 frame 都是 dirty 时, 以每秒 TESTRATE 个 page 运行约 TESTMS 毫秒,
+ * 写回的 page 数应与限速乘以实际经过的时间相符. 每秒少于 1000 个 page 的速率曾被取整为每轮一个 page
+*/
+
+#define TESTFRAMES 1024
+#define TESTMS 1000
+#define TESTTOLERANCE 0.2 // 允许的相对误差
+
+static bool check_rate(int rate)
+{
+    DataStorageManager dsmgr {PAGESIZE, TESTFRAMES};
+    dsmgr.open_file("", DataStorageManager::NONE);
+    while (dsmgr.get_num_pages() < TESTFRAMES) {
+        dsmgr.inc_num_pages();
+    }
+    BufferManager bufmgr {&dsmgr, Replacer::LRU, TESTFRAMES, true};
+    for (int i = 0; i < TESTFRAMES; i++) {
+        bufmgr.fix_page(i, true);
+        bufmgr.unfix_page(i);
+    }
+    auto before = std::chrono::steady_clock::now();
+    bufmgr.start_cleaner(0, TESTFRAMES, rate);
+    std::this_thread::sleep_for(std::chrono::milliseconds(TESTMS));
+    bufmgr.stop_cleaner();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - before).count();
+    int written = bufmgr.clean_count;
+    double expected = rate * seconds;
+    bool ok = written >= expected * (1 - TESTTOLERANCE) - 1 && written <= expected * (1 + TESTTOLERANCE) + 1;
+    std::cout << "rate " << rate << ": " << written << " pages in " << seconds << "s, expected " << expected
+        << (ok ? "" : " FAILED") << std::endl;
+    return ok;
+}
+
+int main()
+{
+    bool ok = true;
+    for (int rate : {10, 100, 500}) {
+        ok = check_rate(rate) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+#include <iostream>
+#include <memory>
+#include "replacers.h"
+
+/**
+ * 删除的 page 不留下 ghost 或历史: 文件复用其 page_id 的新 page 应如同第一次被访问.
+ * 1. 在替换算法上: 换入并访问 page X, 以不同方式移出后再次换入 X, 之后换入 page Y.
+ *    X 被换出 (remove_bcb) 时保留的 ghost/历史使 X 比 Y 热, Y 先被换出; X 被删除 (discard_bcb) 或其 ghost 被丢弃
+ *    (forget_page) 时两者都是新 page, 先换入的 X 先被换出
+ * 2. 在 2Q 的 BufferManager 上: 访问并删除 page 后重新分配得到同一 page_id, 它应进入 A1in 而不是 Am
+*/
+
+#define TESTFRAMES 4
+#define PAGEX 7
+#define PAGEY 8
+
+enum Removal {EVICT, DISCARD, EVICT_FORGET};
+
+static int victim_after(Replacer::Algo algo, Removal removal)
+{
+    ReplacerParams params;
+    params.retained_history = 16;
+    std::unique_ptr<Replacer> replacer {Replacer::create(algo, TESTFRAMES, TESTFRAMES, params)};
+    BCB bcbs[TESTFRAMES];
+    for (int i = 0; i < TESTFRAMES; i++) {
+        bcbs[i].frame_id = i;
+    }
+    BCB *x = &bcbs[0], *y = &bcbs[1];
+    x->page_id = PAGEX;
+    y->page_id = PAGEY;
+    replacer->insert_bcb(x, false);
+    replacer->access_frame(x, false);
+    if (removal == DISCARD) {
+        replacer->discard_bcb(x);
+    } else {
+        replacer->remove_bcb(x);
+    }
+    if (removal == EVICT_FORGET) {
+        replacer->forget_page(PAGEX);
+    }
+    replacer->insert_bcb(x, false);
+    replacer->insert_bcb(y, false);
+    BCB *victim = replacer->select_victim();
+    return victim == nullptr ? -1 : victim->page_id;
+}
+
+static bool check_replacer(Replacer::Algo algo, const char *name)
+{
+    bool ok = true;
+    const char *removals[] = {"evict", "discard", "evict + forget"};
+    for (Removal removal : {EVICT, DISCARD, EVICT_FORGET}) {
+        int expected = removal == EVICT ? PAGEY : PAGEX;
+        int victim = victim_after(algo, removal);
+        if (victim != expected) {
+            std::cout << name << " " << removals[removal] << ": victim " << victim << ", expected " << expected << " FAILED" << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// 缓冲区全部为只访问过 1 次的新 page 时, 2Q 从 A1in 换出最早的; 被删除的 page 若进入了 A1out,
+// 重新分配后会进入 Am, 换出的就不是它了
+static bool check_free_page()
+{
+    DataStorageManager dsmgr {PAGESIZE, 64};
+    dsmgr.open_file("", DataStorageManager::NONE);
+    BufferManager bufmgr {&dsmgr, Replacer::TWO_QUEUE, TESTFRAMES};
+    PageFrame freed = bufmgr.fix_new_page();
+    bufmgr.unfix_page(freed.page_id);
+    bufmgr.fix_page(freed.page_id, false);
+    bufmgr.unfix_page(freed.page_id);
+    bufmgr.free_page(freed.page_id);
+    PageFrame reused = bufmgr.fix_new_page();
+    bufmgr.unfix_page(reused.page_id);
+    for (int i = 0; i < TESTFRAMES; i++) { // 填满缓冲区后再换入一个, 换出最早的 page
+        bufmgr.unfix_page(bufmgr.fix_new_page().page_id);
+    }
+    int hits = bufmgr.hit_count;
+    bufmgr.fix_page(reused.page_id, false);
+    bufmgr.unfix_page(reused.page_id);
+    bool ok = reused.page_id == freed.page_id && bufmgr.hit_count == hits;
+    if (!ok) {
+        std::cout << "2q free_page: reused page " << reused.page_id << " of " << freed.page_id
+            << (bufmgr.hit_count == hits ? "" : " stayed in the pool") << " FAILED" << std::endl;
+    }
+    return ok;
+}
+
+int main()
+{
+    bool ok = true;
+    ok = check_replacer(Replacer::TWO_QUEUE, "2q") && ok;
+    ok = check_replacer(Replacer::LRU_K, "lru-k") && ok;
+    ok = check_replacer(Replacer::ARC, "arc") && ok;
+    ok = check_replacer(Replacer::CAR, "car") && ok;
+    ok = check_replacer(Replacer::CLOCK_PRO, "clock-pro") && ok;
+    ok = check_free_page() && ok;
+    std::cout << (ok ? "all passed" : "some FAILED") << std::endl;
+    return ok ? 0 : 1;
+}